@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    BinaryState.cpp
+
+    Compact, versioned save format for the processor's parameters.
+
+  ==============================================================================
+*/
+
+#include "BinaryState.h"
+
+namespace
+{
+    juce::uint16 readUint16 (const juce::uint8* data) noexcept     { return juce::ByteOrder::littleEndianShort (data); }
+    juce::uint32 readUint32 (const juce::uint8* data) noexcept     { return juce::ByteOrder::littleEndianInt (data); }
+
+    float readFloat (const juce::uint8* data) noexcept
+    {
+        auto bits = readUint32 (data);
+        float value;
+        std::memcpy (&value, &bits, sizeof (value));
+        return value;
+    }
+
+    void writeUint16 (juce::uint8* data, juce::uint16 value) noexcept
+    {
+        data[0] = (juce::uint8) (value & 0xff);
+        data[1] = (juce::uint8) (value >> 8);
+    }
+
+    void writeUint32 (juce::uint8* data, juce::uint32 value) noexcept
+    {
+        for (int i = 0; i < 4; ++i)
+            data[i] = (juce::uint8) (value >> (8 * i));
+    }
+
+    void writeFloat (juce::uint8* data, float value) noexcept
+    {
+        juce::uint32 bits;
+        std::memcpy (&bits, &value, sizeof (bits));
+        writeUint32 (data, bits);
+    }
+}
+
+//==============================================================================
+BinaryState::BinaryState (juce::AudioProcessor& processor)
+{
+    for (auto* parameter : processor.getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            mEntries.push_back ({ hashParameterID (ranged->paramID), ranged });
+
+    std::sort (mEntries.begin(), mEntries.end(), [] (const Entry& a, const Entry& b) { return a.id < b.id; });
+
+    // Two IDs with the same hash would load into each other; rename one of them
+    for (size_t i = 1; i < mEntries.size(); ++i)
+        jassert (mEntries[i - 1].id != mEntries[i].id);
+
+    mPendingValues.resize (mEntries.size());
+}
+
+juce::uint32 BinaryState::hashParameterID (const juce::String& id) noexcept
+{
+    juce::uint32 hash = 2166136261u;
+
+    for (auto* c = id.toRawUTF8(); *c != 0; ++c)
+    {
+        hash ^= (juce::uint8) *c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+bool BinaryState::isBinaryState (const void* data, int sizeInBytes) noexcept
+{
+    return data != nullptr && sizeInBytes >= headerSize
+        && readUint32 (static_cast<const juce::uint8*> (data)) == magic;
+}
+
+int BinaryState::findParameter (juce::uint32 id) const noexcept
+{
+    auto found = std::lower_bound (mEntries.begin(), mEntries.end(), id,
+                                   [] (const Entry& entry, juce::uint32 value) { return entry.id < value; });
+
+    return found != mEntries.end() && found->id == id ? (int) std::distance (mEntries.begin(), found) : -1;
+}
+
+//==============================================================================
+void BinaryState::save (juce::MemoryBlock& destData, const juce::MemoryBlock& extension) const
+{
+    destData.setSize ((size_t) (headerSize + entrySize * (int) mEntries.size() + 4) + extension.getSize());
+    auto* data = static_cast<juce::uint8*> (destData.getData());
+
+    writeUint32 (data, magic);
+    writeUint16 (data + 4, currentVersion);
+    writeUint16 (data + 6, minReaderVersion);
+    writeUint32 (data + 8, (juce::uint32) mEntries.size());
+
+    data += headerSize;
+
+    for (auto& entry : mEntries)
+    {
+        auto* parameter = entry.parameter;
+
+        writeUint32 (data, entry.id);
+        writeFloat (data + 4, parameter->convertFrom0to1 (parameter->getValue()));
+        data += entrySize;
+    }
+
+    writeUint32 (data, (juce::uint32) extension.getSize());
+
+    if (extension.getSize() > 0)
+        std::memcpy (data + 4, extension.getData(), extension.getSize());
+}
+
+bool BinaryState::load (const void* data, int sizeInBytes, juce::MemoryBlock* extension)
+{
+    if (! isBinaryState (data, sizeInBytes))
+        return false;
+
+    auto* bytes = static_cast<const juce::uint8*> (data);
+
+    auto version = (int) readUint16 (bytes + 4);
+    auto readerVersion = (int) readUint16 (bytes + 6);
+    auto numEntries = (int) readUint32 (bytes + 8);
+
+    if (readerVersion > currentVersion || numEntries < 0 || numEntries > (sizeInBytes - headerSize) / entrySize)
+        return false;
+
+    /*
+        Everything starts from its default, so a parameter the state doesn't
+        mention ends up where a new instance would have it.
+    */
+
+    for (size_t i = 0; i < mEntries.size(); ++i)
+        mPendingValues[i] = mEntries[i].parameter->convertFrom0to1 (mEntries[i].parameter->getDefaultValue());
+
+    bytes += headerSize;
+
+    for (int i = 0; i < numEntries; ++i, bytes += entrySize)
+    {
+        auto id = readUint32 (bytes);
+        auto value = readFloat (bytes + 4);
+
+        if (! std::isfinite (value))
+            continue;
+
+        migrate (version, id, value);
+
+        auto index = findParameter (id);
+
+        if (index >= 0)
+            mPendingValues[(size_t) index] = value;
+    }
+
+    if (extension != nullptr)
+    {
+        extension->reset();
+
+        auto remaining = sizeInBytes - headerSize - numEntries * entrySize;
+
+        if (version >= 2 && remaining >= 4)
+        {
+            auto extensionSize = (int) juce::jmin ((juce::uint32) (remaining - 4), readUint32 (bytes));
+            extension->append (bytes + 4, (size_t) extensionSize);
+        }
+    }
+
+    // Only parameters that actually move tell the host
+    for (size_t i = 0; i < mEntries.size(); ++i)
+    {
+        auto* parameter = mEntries[i].parameter;
+        auto normalised = parameter->convertTo0to1 (mPendingValues[i]);
+
+        if (normalised != parameter->getValue())
+            parameter->setValueNotifyingHost (normalised);
+    }
+
+    return true;
+}
+
+void BinaryState::migrate (int version, juce::uint32 id, float& value) noexcept
+{
+    /*
+        Brings a value saved by an older version up to date. Each case moves
+        it on by one version and falls through to the next, so any old state
+        ends up current. Version 1 is the first, so nothing needs it yet;
+        it already held the delay times in milliseconds. The states from
+        before it, in samples, are XML, and the processor converts those.
+    */
+
+    juce::ignoreUnused (id, value);
+
+    switch (version)
+    {
+        case 1:
+        default:
+            break;
+    }
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    BinaryState.h
+
+    Compact, versioned save format for the processor's parameters.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Saves and loads every parameter as a flat list of (ID hash, value) pairs
+    behind a small header, instead of going through a ValueTree and XML. A
+    load is one pass over the data, with no text to parse and no tree built.
+
+    All fields are little endian;
+
+        uint32  magic               'TTbs'
+        uint16  version             The format it was written with
+        uint16  minReaderVersion    The oldest format that can still read it
+        uint32  numEntries
+        numEntries times;
+            uint32  id              FNV-1a hash of the parameter ID
+            float32 value           In the parameter's own units, not 0 to 1
+        From version 2;
+        uint32  extensionSize
+        extensionSize bytes         The processor's own data, e.g. its programs
+
+    The IDs are hashed from the parameter ID strings, so they stay the same
+    from build to build whatever order the parameters are created in, and the
+    values are plain, so a range that changes later still loads the same
+    setting.
+
+    An ID the processor doesn't know (saved by a newer build) is skipped, and
+    a parameter with no entry (added after the state was saved) goes back to
+    its default. A change to the layout bumps minReaderVersion, so an older
+    build rejects what it can't read rather than misreading it. Anything that
+    changes a parameter's meaning goes in migrate(), keyed on the version the
+    state was written with. Version 2 only added the extension after the
+    entries, which version 1 readers never look at, so it still reads as 1.
+*/
+class BinaryState
+{
+public:
+    static constexpr juce::uint32 magic = 0x73625454;  // "TTbs"
+    static constexpr juce::uint16 currentVersion = 2;
+    static constexpr juce::uint16 minReaderVersion = 1;
+
+    /** Indexes the processor's parameters; create it once they have all been added. */
+    explicit BinaryState (juce::AudioProcessor& processor);
+
+    /** Writes every parameter's current value, then the extension. */
+    void save (juce::MemoryBlock& destData, const juce::MemoryBlock& extension = {}) const;
+
+    /**
+        Sets every parameter from a saved state. Returns false, touching
+        nothing, if the data isn't in this format (e.g. an old XML state) or
+        was written by a newer layout than this build can read. The
+        extension, if asked for, is left empty for a version 1 state.
+    */
+    bool load (const void* data, int sizeInBytes, juce::MemoryBlock* extension = nullptr);
+
+    /** True if the data starts with this format's header. */
+    static bool isBinaryState (const void* data, int sizeInBytes) noexcept;
+
+    static juce::uint32 hashParameterID (const juce::String& id) noexcept;
+
+private:
+    struct Entry
+    {
+        juce::uint32 id;
+        juce::RangedAudioParameter* parameter;
+    };
+
+    static constexpr int headerSize = 12;
+    static constexpr int entrySize = 8;
+
+    int findParameter (juce::uint32 id) const noexcept;
+    static void migrate (int version, juce::uint32 id, float& value) noexcept;
+
+    std::vector<Entry> mEntries;        // Sorted by id
+    std::vector<float> mPendingValues;  // One per entry, reused by every load
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BinaryState)
+};
@@ -0,0 +1,396 @@
+/*
+  ==============================================================================
+
+    Crossover.h
+
+    Linkwitz-Riley band splitter for PingPongEngine's multiband mode.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DspCore.h"
+
+#include <utility>
+
+//==============================================================================
+/**
+    Splits each channel into up to maxBands bands with 4th order Linkwitz-Riley
+    crossovers, for the multiband ping-pong. The bands add back up to the input
+    with a flat response, only its phase is turned round at each crossover.
+
+    The split is a two level tree, so no band works out a filter another band
+    has already been through;
+
+        branches    the middle crossover splits the input into a low and a
+                    high branch; each branch also gets the allpass of the
+                    crossover inside the other one, so they all line up
+        bands       the crossover inside each branch splits it into its
+                    bands; a branch with only one band passes straight through
+
+    Each level is a Pass that runs the same chain of biquads over all of its
+    lanes, only with each lane's own coefficients, and the lanes sit side by
+    side in DspCore::SimdRegisters the same way as FeedbackFilter's. The
+    branches are laid out branch after branch (lane = branch * numChannels +
+    channel), padded out to a whole register; the bands pass runs over two
+    copies of that layout, the first band of each branch in the first copy
+    and the second in the other, so each of its registers reads one of the
+    branch registers just as it is. The four bands of a stereo signal take
+    one register of floats for the branches and two for the bands, seven
+    biquads a sample in all where a chain per band would take twelve.
+*/
+namespace Crossover
+{
+    static constexpr int maxBands = 4;
+    static constexpr int maxLanes = 16;
+    static constexpr int maxCrossovers = maxBands - 1;
+    static constexpr int maxSections = 3;               // A Linkwitz-Riley filter is two Butterworth biquads, plus an allpass
+    static constexpr int laneAlignment = 4;             // The widest DspCore::SimdRegister
+    static constexpr int maxPassLanes = 2 * maxLanes;   // Two copies of the branches, padded out
+
+    //==============================================================================
+    /** One biquad section for every lane, as in FeedbackFilter::Biquad but one value per lane. */
+    struct Sections
+    {
+        std::array<float, maxPassLanes> b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    };
+
+    /** One level of the split; every lane runs through numSections sections. */
+    struct Pass
+    {
+        int numSections = 0;
+        std::array<Sections, maxSections> sections;
+    };
+
+    struct Coefficients
+    {
+        int numBands = 1;
+        int numChannels = 1;
+
+        /*
+            The branch lanes padded out to a whole register of either sample
+            type, which is how many lanes the bands pass reads too; with
+            more than two bands each copy of the bands pass takes this many.
+        */
+        int numBranchLanes = laneAlignment;
+
+        Pass branches, bands;
+        std::array<int, maxLanes> outputs {};       // Where band * numChannels + channel ends up in the last pass
+
+        int getNumLanes() const noexcept    { return numBands * numChannels; }
+    };
+
+    template <typename SampleType>
+    struct PassState
+    {
+        std::array<std::array<SampleType, maxPassLanes>, maxSections> s1 {}, s2 {};
+    };
+
+    template <typename SampleType>
+    struct State
+    {
+        PassState<SampleType> branches, bands;
+    };
+
+    //==============================================================================
+    /**
+        Works out the coefficients for numBands bands of numChannels channels,
+        from the crossover frequencies, low to high. Only the first
+        numBands - 1 frequencies are used; they are kept in order and below
+        Nyquist.
+    */
+    inline Coefficients makeCoefficients (double sampleRate, int numBands, int numChannels,
+                                          const std::array<float, maxCrossovers>& frequencies) noexcept
+    {
+        Coefficients c;
+
+        c.numBands = std::clamp (numBands, 1, maxBands);
+        c.numChannels = std::clamp (numChannels, 1, maxLanes / c.numBands);
+
+        enum class Shape { lowPass, highPass, allPass, through };
+
+        /*
+            The usual Butterworth (Q of 1/sqrt 2) bilinear designs. A pair of
+            the low-passes and a pair of the high-passes add up to the allpass
+            with the same Q, which is why one allpass section matches them.
+        */
+
+        auto setSection = [] (Sections& s, int lane, Shape shape, double w)
+        {
+            auto cosW = std::cos (w);
+            auto alpha = std::sin (w) / std::sqrt (2.0);
+            auto a0 = 1.0 + alpha;
+
+            double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = -2.0 * cosW / a0, a2 = (1.0 - alpha) / a0;
+
+            switch (shape)
+            {
+                case Shape::lowPass:    b0 = b2 = (1.0 - cosW) / 2.0; b1 = 1.0 - cosW;      break;
+                case Shape::highPass:   b0 = b2 = (1.0 + cosW) / 2.0; b1 = -(1.0 + cosW);   break;
+                case Shape::allPass:    b0 = 1.0 - alpha; b1 = -2.0 * cosW; b2 = 1.0 + alpha; break;
+                case Shape::through:    a0 = 1.0; a1 = a2 = 0.0;                            break;
+                default:                break;
+            }
+
+            auto index = (size_t) lane;
+
+            s.b0[index] = (float) (b0 / a0);
+            s.b1[index] = (float) (b1 / a0);
+            s.b2[index] = (float) (b2 / a0);
+            s.a1[index] = (float) a1;
+            s.a2[index] = (float) a2;
+        };
+
+        std::array<double, maxCrossovers> w {};
+        auto nyquistLimit = sampleRate * 0.45;
+        auto previousHz = 20.0;
+
+        for (int crossover = 0; crossover < c.numBands - 1; ++crossover)
+        {
+            auto hz = std::clamp ((double) frequencies[(size_t) crossover], previousHz, nyquistLimit);
+            w[(size_t) crossover] = DspCore::twoPi<double> * hz / sampleRate;
+            previousHz = hz;
+        }
+
+        /*
+            Bands below split are in the low branch and the rest in the high
+            one, so a branch holds one band or two; crossover n lies between
+            bands n and n + 1.
+        */
+        auto numBranches = std::min (c.numBands, 2);
+        auto split = std::max (1, c.numBands / 2);
+
+        auto getFirstBand = [&] (int branch)    { return branch == 0 ? 0 : split; };
+        auto hasTwoBands = [&] (int branch)     { return (branch == 0 ? split : c.numBands - split) == 2; };
+
+        c.numBranchLanes = (numBranches * c.numChannels + laneAlignment - 1) / laneAlignment * laneAlignment;
+        c.branches.numSections = c.numBands == 1 ? 0 : (c.numBands == 2 ? 2 : 3);
+
+        for (int branch = 0; branch < numBranches; ++branch)
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+            {
+                auto lane = branch * c.numChannels + channel;
+
+                if (c.numBands > 1)
+                {
+                    auto shape = branch == 0 ? Shape::lowPass : Shape::highPass;
+                    setSection (c.branches.sections[0], lane, shape, w[(size_t) split - 1]);
+                    setSection (c.branches.sections[1], lane, shape, w[(size_t) split - 1]);
+                }
+
+                if (c.numBands > 2)
+                {
+                    auto other = 1 - branch;
+                    auto shape = hasTwoBands (other) ? Shape::allPass : Shape::through;
+                    setSection (c.branches.sections[2], lane, shape, w[(size_t) getFirstBand (other)]);
+                }
+            }
+        }
+
+        // With two bands or fewer the branches are the bands
+        c.bands.numSections = c.numBands > 2 ? 2 : 0;
+
+        for (int band = 0; band < c.numBands; ++band)
+        {
+            auto branch = band < split ? 0 : 1;
+            auto first = getFirstBand (branch);
+
+            for (int channel = 0; channel < c.numChannels; ++channel)
+            {
+                auto lane = branch * c.numChannels + channel;
+
+                if (c.numBands > 2)
+                {
+                    lane += (band - first) * c.numBranchLanes;
+
+                    auto shape = ! hasTwoBands (branch) ? Shape::through
+                                                        : (band == first ? Shape::lowPass : Shape::highPass);
+
+                    setSection (c.bands.sections[0], lane, shape, w[(size_t) first]);
+                    setSection (c.bands.sections[1], lane, shape, w[(size_t) first]);
+                }
+
+                c.outputs[(size_t) (band * c.numChannels + channel)] = lane;
+            }
+        }
+
+        return c;
+    }
+
+    //==============================================================================
+    namespace Detail
+    {
+        constexpr int chunkLength = 32;
+
+        /** Calls function with 0 to count - 1, each as a compile-time constant, so whatever it indexes can stay in registers. */
+        template <typename Function, int... indices>
+        void unroll (Function&& function, std::integer_sequence<int, indices...>) noexcept
+        {
+            (function (std::integral_constant<int, indices>()), ...);
+        }
+
+        template <int count, typename Function>
+        void unroll (Function&& function) noexcept
+        {
+            unroll (function, std::make_integer_sequence<int, count>());
+        }
+
+        /*
+            Runs a pass over one chunk, transposed so that sample i's lanes are
+            next to each other. The input lanes are in numInputRegisters
+            registers, and the pass runs over numCopies copies of them, so
+            output register r reads input register r % numInputRegisters; the
+            registers hold the whole state between samples. With the b
+            coefficients folded in, as in FeedbackFilter, a biquad is
+
+                y = b0 x + s1
+                s1 = (s2 + (b1 - a1 b0) x) - a1 s1
+                s2 = (b2 - a2 b0) x - a2 s1
+        */
+        template <typename SampleType, int numSections, int numCopies, int numInputRegisters>
+        void processRegisters (const Pass& pass, PassState<SampleType>& state,
+                               const SampleType* input, SampleType* output, int length) noexcept
+        {
+            using Register = DspCore::SimdRegister<SampleType>;
+            constexpr int numRegisters = numCopies * numInputRegisters;
+            constexpr int inputStride = numInputRegisters * Register::size;
+            constexpr int outputStride = numRegisters * Register::size;
+
+            using Registers = std::array<std::array<Register, numRegisters>, numSections>;
+            Registers b0, k1, k2, a1, a2, s1, s2;
+
+            // Padding lanes have no coefficients, so they only ever put out silence
+            auto getLanes = [] (const std::array<float, maxPassLanes>& values, size_t r)
+            {
+                SampleType lanes[Register::size];
+
+                for (size_t j = 0; j < (size_t) Register::size; ++j)
+                    lanes[j] = (SampleType) values[r * Register::size + j];
+
+                return Register::load (lanes);
+            };
+
+            for (size_t section = 0; section < (size_t) numSections; ++section)
+            {
+                auto& from = pass.sections[section];
+
+                for (size_t r = 0; r < (size_t) numRegisters; ++r)
+                {
+                    b0[section][r] = getLanes (from.b0, r);
+                    a1[section][r] = getLanes (from.a1, r);
+                    a2[section][r] = getLanes (from.a2, r);
+                    k1[section][r] = getLanes (from.b1, r) - a1[section][r] * b0[section][r];
+                    k2[section][r] = getLanes (from.b2, r) - a2[section][r] * b0[section][r];
+                    s1[section][r] = Register::load (state.s1[section].data() + r * Register::size);
+                    s2[section][r] = Register::load (state.s2[section].data() + r * Register::size);
+                }
+            }
+
+            for (int i = 0; i < length; ++i)
+            {
+                unroll<numRegisters> ([&] (auto r)
+                {
+                    auto x = Register::load (input + i * inputStride + (r % numInputRegisters) * Register::size);
+
+                    unroll<numSections> ([&] (auto n)
+                    {
+                        auto y = b0[n][r] * x + s1[n][r];
+                        auto next = (s2[n][r] + k1[n][r] * x) - a1[n][r] * s1[n][r];
+                        s2[n][r] = k2[n][r] * x - a2[n][r] * s1[n][r];
+                        s1[n][r] = next;
+                        x = y;
+                    });
+
+                    x.store (output + i * outputStride + r * Register::size);
+                });
+            }
+
+            for (size_t section = 0; section < (size_t) numSections; ++section)
+            {
+                for (size_t r = 0; r < (size_t) numRegisters; ++r)
+                {
+                    s1[section][r].store (state.s1[section].data() + r * Register::size);
+                    s2[section][r].store (state.s2[section].data() + r * Register::size);
+                }
+            }
+        }
+
+        /** Picks how many lanes the pass reads, padded as in Coefficients::numBranchLanes, at compile time. */
+        template <typename SampleType, int numSections, int numCopies, int numInputLanes = laneAlignment>
+        void processLanes (const Pass& pass, PassState<SampleType>& state, int numBranchLanes,
+                           const SampleType* input, SampleType* output, int length) noexcept
+        {
+            if constexpr (numInputLanes < maxLanes)
+            {
+                if (numBranchLanes > numInputLanes)
+                {
+                    processLanes<SampleType, numSections, numCopies, numInputLanes + laneAlignment> (pass, state, numBranchLanes, input, output, length);
+                    return;
+                }
+            }
+
+            constexpr int numInputRegisters = numInputLanes / DspCore::SimdRegister<SampleType>::size;
+            processRegisters<SampleType, numSections, numCopies, numInputRegisters> (pass, state, input, output, length);
+        }
+    }
+
+    /**
+        Splits numChannels source spans into getNumLanes() band spans, band
+        after band. The source isn't touched, so it can still be used as the
+        dry signal afterwards.
+    */
+    template <typename SampleType>
+    void process (const Coefficients& c, State<SampleType>& state,
+                  const SampleType* const* source, SampleType* const* bands, int numSamples) noexcept
+    {
+        static_assert (laneAlignment % DspCore::SimdRegister<SampleType>::size == 0, "A register has to fit the padding");
+        assert (c.getNumLanes() <= maxLanes);
+
+        const auto numInputLanes = std::min (c.numBands, 2) * c.numChannels;
+        const auto numLanes = c.getNumLanes();
+        const auto numBranchLanes = c.numBranchLanes;
+        const auto hasBandsPass = c.bands.numSections > 0;
+        const auto outputStride = hasBandsPass ? 2 * numBranchLanes : numBranchLanes;
+
+        // Copied out, so the compiler can see that writing the bands doesn't move them
+        const auto outputs = c.outputs;
+
+        // Lanes past the branches stay silent
+        SampleType branchChunk[Detail::chunkLength * maxLanes] = {};
+        SampleType bandChunk[Detail::chunkLength * maxPassLanes] = {};
+
+        auto* last = hasBandsPass ? bandChunk : branchChunk;
+
+        for (int start = 0; start < numSamples; start += Detail::chunkLength)
+        {
+            auto length = std::min (Detail::chunkLength, numSamples - start);
+
+            for (int lane = 0; lane < numInputLanes; ++lane)
+            {
+                auto* input = source[lane % c.numChannels] + start;
+
+                for (int i = 0; i < length; ++i)
+                    branchChunk[i * numBranchLanes + lane] = input[i];
+            }
+
+            if (c.branches.numSections == 3)
+                Detail::processLanes<SampleType, 3, 1> (c.branches, state.branches, numBranchLanes, branchChunk, branchChunk, length);
+            else if (c.branches.numSections == 2)
+                Detail::processLanes<SampleType, 2, 1> (c.branches, state.branches, numBranchLanes, branchChunk, branchChunk, length);
+
+            if (hasBandsPass)
+                Detail::processLanes<SampleType, 2, 2> (c.bands, state.bands, numBranchLanes, branchChunk, bandChunk, length);
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                auto* output = bands[lane] + start;
+                auto from = outputs[(size_t) lane];
+
+                for (int i = 0; i < length; ++i)
+                    output[i] = last[i * outputStride + from];
+            }
+        }
+    }
+}
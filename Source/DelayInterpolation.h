@@ -0,0 +1,366 @@
+/*
+  ==============================================================================
+
+    DelayInterpolation.h
+
+    Fractional delay interpolators for PingPongKernel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DspCore.h"
+
+//==============================================================================
+/**
+    The ways a delay can be read between samples, cheapest first.
+
+    Each interpolator is a struct of static functions that the kernel takes as a
+    template argument, so the choice is made once per block and the inner loops
+    compile down to just that interpolator's maths.
+
+    For a read position n + fraction, an interpolator looks at the samples from
+    n - before to n + after. Its coefficients only depend on the fraction, so a
+    steady delay works them out once per span.
+
+    A gliding delay reads every sample at its own position. The kernel works
+    those out a chunk at a time and hands them to process(), which gathers the
+    points out of the line and then runs the maths a whole SIMD register of
+    samples at a time (or, for the sinc, a register of points at a time).
+    Only the Thiran allpass, which feeds back on itself, goes sample by sample.
+*/
+namespace DelayInterpolation
+{
+    enum class Type
+    {
+        none,           // Rounds to the nearest sample
+        linear,
+        lagrange3rd,
+        thiran,         // First order allpass, flat magnitude
+        windowedSinc    // 16 point windowed sinc, for high quality offline renders
+    };
+
+    /** The most samples process() is given at once. */
+    static constexpr int chunkLength = 32;
+
+    //==============================================================================
+    struct None
+    {
+        static constexpr int before = 0;
+        static constexpr int after = 0;
+
+        struct Coefficients {};
+
+        static Coefficients getCoefficients (float) noexcept                                { return {}; }
+        template <typename SampleType>
+        static SampleType apply (const SampleType* x, const Coefficients&, SampleType&) noexcept   { return x[0]; }
+
+        /** Reads sample indices[i] of a line of mask + 1 samples into dest[i]; the indices aren't wrapped yet. */
+        template <typename SampleType>
+        static void process (const SampleType* line, int mask, const int* indices, const float*,
+                             SampleType* dest, int numSamples, SampleType&) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = line[indices[i] & mask];
+        }
+    };
+
+    //==============================================================================
+    struct Linear
+    {
+        static constexpr int before = 0;
+        static constexpr int after = 1;
+
+        struct Coefficients { float fraction; };
+
+        static Coefficients getCoefficients (float fraction) noexcept                       { return { fraction }; }
+
+        template <typename SampleType>
+        static SampleType apply (const SampleType* x, const Coefficients& c, SampleType&) noexcept
+        {
+            return x[0] + (SampleType) c.fraction * (x[1] - x[0]);
+        }
+
+        template <typename SampleType>
+        static void process (const SampleType* line, int mask, const int* indices, const float* fractions,
+                             SampleType* dest, int numSamples, SampleType&) noexcept
+        {
+            using Register = DspCore::SimdRegister<SampleType>;
+
+            SampleType x0[chunkLength], x1[chunkLength];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                x0[i] = line[indices[i] & mask];
+                x1[i] = line[(indices[i] + 1) & mask];
+            }
+
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+            {
+                auto a = Register::load (x0 + i);
+                (a + Register::load (fractions + i) * (Register::load (x1 + i) - a)).store (dest + i);
+            }
+
+            for (; i < numSamples; ++i)
+                dest[i] = x0[i] + (SampleType) fractions[i] * (x1[i] - x0[i]);
+        }
+    };
+
+    //==============================================================================
+    struct Lagrange3rd
+    {
+        static constexpr int before = 1;
+        static constexpr int after = 2;
+
+        struct Coefficients { float c[4]; };
+
+        static Coefficients getCoefficients (float f) noexcept
+        {
+            // Third order Lagrange polynomial through the points at -1, 0, 1 and 2
+            auto fPlus1 = f + 1.f;
+            auto fMinus1 = f - 1.f;
+            auto fMinus2 = f - 2.f;
+
+            return { { -f * fMinus1 * fMinus2 / 6.f,
+                       fPlus1 * fMinus1 * fMinus2 / 2.f,
+                       -fPlus1 * f * fMinus2 / 2.f,
+                       fPlus1 * f * fMinus1 / 6.f } };
+        }
+
+        template <typename SampleType>
+        static SampleType apply (const SampleType* x, const Coefficients& c, SampleType&) noexcept
+        {
+            return (SampleType) c.c[0] * x[-1] + (SampleType) c.c[1] * x[0]
+                 + (SampleType) c.c[2] * x[1] + (SampleType) c.c[3] * x[2];
+        }
+
+        template <typename SampleType>
+        static void process (const SampleType* line, int mask, const int* indices, const float* fractions,
+                             SampleType* dest, int numSamples, SampleType& state) noexcept
+        {
+            using Register = DspCore::SimdRegister<SampleType>;
+
+            // The points of each sample, one array per point, so a register holds one point of several samples
+            SampleType x[4][chunkLength];
+
+            for (int i = 0; i < numSamples; ++i)
+                for (int k = 0; k < 4; ++k)
+                    x[k][i] = line[(indices[i] + k - 1) & mask];
+
+            const auto one = Register::expand (1), two = Register::expand (2);
+            const auto sixth = Register::expand ((SampleType) 1 / 6), half = Register::expand ((SampleType) 0.5);
+
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+            {
+                auto f = Register::load (fractions + i);
+                auto fPlus1 = f + one, fMinus1 = f - one, fMinus2 = f - two;
+                auto outer = f * fMinus1 * sixth, inner = fPlus1 * fMinus2 * half;
+
+                auto y = Register::load (x[3] + i) * fPlus1 * outer - Register::load (x[0] + i) * fMinus2 * outer
+                       + Register::load (x[1] + i) * fMinus1 * inner - Register::load (x[2] + i) * f * inner;
+
+                y.store (dest + i);
+            }
+
+            for (; i < numSamples; ++i)
+            {
+                SampleType points[] = { x[0][i], x[1][i], x[2][i], x[3][i] };
+                dest[i] = apply (points + 1, getCoefficients (fractions[i]), state);
+            }
+        }
+    };
+
+    //==============================================================================
+    /**
+        A first order Thiran allpass; y = a * u[m] + u[m - 1] - a * y[m - 1].
+
+        The allpass delays its input u by between half and one and a half samples,
+        so the input is taken one or two samples ahead of n. The previous output is
+        kept in the state the kernel passes in, one per read head.
+    */
+    struct Thiran
+    {
+        static constexpr int before = 0;
+        static constexpr int after = 2;
+
+        struct Coefficients
+        {
+            int offset;     // Where u[m] is, relative to n
+            float a;
+        };
+
+        static Coefficients getCoefficients (float f) noexcept
+        {
+            auto offset = f < 0.5f ? 1 : 2;
+            auto delta = (float) offset - f;
+
+            return { offset, (1.f - delta) / (1.f + delta) };
+        }
+
+        template <typename SampleType>
+        static SampleType apply (const SampleType* x, const Coefficients& c, SampleType& state) noexcept
+        {
+            auto a = (SampleType) c.a;
+            auto y = a * x[c.offset] + x[c.offset - 1] - a * state;
+            state = y;
+            return y;
+        }
+
+        template <typename SampleType>
+        static void process (const SampleType* line, int mask, const int* indices, const float* fractions,
+                             SampleType* dest, int numSamples, SampleType& state) noexcept
+        {
+            // Each output feeds the next, so this one stays a sample at a time
+            for (int i = 0; i < numSamples; ++i)
+            {
+                SampleType x[] = { line[indices[i] & mask], line[(indices[i] + 1) & mask], line[(indices[i] + 2) & mask] };
+                dest[i] = apply (x, getCoefficients (fractions[i]), state);
+            }
+        }
+    };
+
+    //==============================================================================
+    /**
+        A 16 point Blackman windowed sinc. The coefficients come from a table of
+        phases, interpolated linearly between neighbouring phases.
+    */
+    struct WindowedSinc
+    {
+        static constexpr int halfLength = 8;
+        static constexpr int numPoints = 2 * halfLength;
+        static constexpr int before = halfLength - 1;
+        static constexpr int after = halfLength;
+        static constexpr int numPhases = 256;
+
+        struct Coefficients { float c[numPoints]; };
+
+        using Table = std::array<std::array<float, numPoints>, numPhases + 1>;
+
+        /** Builds the table the first time it is asked for; call it from prepare(). */
+        static const Table& getTable()
+        {
+            static const Table table = []
+            {
+                Table t {};
+
+                for (int phase = 0; phase <= numPhases; ++phase)
+                {
+                    auto fraction = (double) phase / (double) numPhases;
+                    auto sum = 0.0;
+
+                    for (int k = 0; k < numPoints; ++k)
+                    {
+                        auto x = (double) (k - before) - fraction;
+                        auto w = DspCore::pi<double> * x;
+                        auto sinc = std::abs (x) < 1.0e-9 ? 1.0 : std::sin (w) / w;
+                        auto window = 0.42 + 0.5 * std::cos (w / halfLength) + 0.08 * std::cos (2.0 * w / halfLength);
+
+                        t[(size_t) phase][(size_t) k] = (float) (sinc * window);
+                        sum += sinc * window;
+                    }
+
+                    // Unity gain at DC
+                    for (auto& c : t[(size_t) phase])
+                        c = (float) (c / sum);
+                }
+
+                return t;
+            }();
+
+            return table;
+        }
+
+        static Coefficients getCoefficients (float f) noexcept
+        {
+            auto& table = getTable();
+
+            auto position = f * (float) numPhases;
+            auto phase = std::clamp ((int) position, 0, numPhases - 1);
+            auto between = position - (float) phase;
+
+            auto& lower = table[(size_t) phase];
+            auto& upper = table[(size_t) phase + 1];
+
+            Coefficients c;
+
+            for (int k = 0; k < numPoints; ++k)
+                c.c[k] = lower[(size_t) k] + between * (upper[(size_t) k] - lower[(size_t) k]);
+
+            return c;
+        }
+
+        template <typename SampleType>
+        static SampleType apply (const SampleType* x, const Coefficients& c, SampleType&) noexcept
+        {
+            SampleType y = 0;
+
+            for (int k = 0; k < numPoints; ++k)
+                y += (SampleType) c.c[k] * x[k - before];
+
+            return y;
+        }
+
+        /*
+            Here it is the points that fill the registers rather than the samples;
+            the coefficients are interpolated between phases and multiplied with
+            the points in the same pass. The points are read straight out of the
+            line unless they wrap round its end.
+        */
+
+        template <typename SampleType>
+        static void process (const SampleType* line, int mask, const int* indices, const float* fractions,
+                             SampleType* dest, int numSamples, SampleType&) noexcept
+        {
+            using Register = DspCore::SimdRegister<SampleType>;
+            static_assert (numPoints % Register::size == 0, "The points must fill whole registers");
+
+            auto& table = getTable();
+            SampleType wrapped[numPoints], sums[Register::size];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto position = fractions[i] * (float) numPhases;
+                auto phase = std::clamp ((int) position, 0, numPhases - 1);
+                auto between = Register::expand ((SampleType) (position - (float) phase));
+
+                auto* lower = table[(size_t) phase].data();
+                auto* upper = table[(size_t) phase + 1].data();
+
+                auto first = (indices[i] - before) & mask;
+                auto* x = line + first;
+
+                if (first + numPoints > mask + 1)
+                {
+                    for (int k = 0; k < numPoints; ++k)
+                        wrapped[k] = line[(first + k) & mask];
+
+                    x = wrapped;
+                }
+
+                auto sum = Register::expand (0);
+
+                for (int k = 0; k < numPoints; k += Register::size)
+                {
+                    auto low = Register::load (lower + k);
+                    sum = sum + (low + between * (Register::load (upper + k) - low)) * Register::load (x + k);
+                }
+
+                sum.store (sums);
+                dest[i] = sums[0];
+
+                for (int k = 1; k < Register::size; ++k)
+                    dest[i] += sums[k];
+            }
+        }
+    };
+
+    //==============================================================================
+    /** The furthest any interpolator looks around n, for sizing scratch space. */
+    static constexpr int maxBefore = WindowedSinc::before;
+    static constexpr int maxAfter = WindowedSinc::after;
+}
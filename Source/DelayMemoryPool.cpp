@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    DelayMemoryPool.cpp
+
+    Process-wide pool of page-aligned memory for the delay lines.
+
+  ==============================================================================
+*/
+
+#include "DelayMemoryPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined (_WIN32)
+ #define NOMINMAX
+ #define WIN32_LEAN_AND_MEAN
+ #include <windows.h>
+ #include <malloc.h>
+#else
+ #include <stdlib.h>
+ #include <unistd.h>
+ #include <fcntl.h>
+ #include <sys/mman.h>
+#endif
+
+#include <vector>
+
+//==============================================================================
+void DelayMemoryPool::Block::reset() noexcept
+{
+    if (mData != nullptr)
+    {
+        if (isMapped())
+            unmapFile (mData, mSize, mFile);
+        else
+            getInstance().release (mData, mSize);
+    }
+
+    mData = nullptr;
+    mSize = 0;
+    mFile = -1;
+}
+
+void DelayMemoryPool::Block::prefetch (size_t offset, size_t numBytes) const noexcept
+{
+   #if ! defined (_WIN32)
+    if (! isMapped() || offset >= mSize)
+        return;
+
+    /*
+        WILLNEED starts reading the pages in, then one byte of each is read,
+        which waits for any that aren't there yet here, rather than on the
+        audio thread later.
+    */
+
+    auto pageSize = getPageSize();
+    auto start = offset / pageSize * pageSize;
+    auto end = std::min (mSize, offset + numBytes);
+
+    auto* data = static_cast<char*> (mData);
+    madvise (data + start, end - start, MADV_WILLNEED);
+
+    for (auto page = start; page < end; page += pageSize)
+        (void) *static_cast<volatile const char*> (data + page);
+   #else
+    (void) offset;
+    (void) numBytes;
+   #endif
+}
+
+void DelayMemoryPool::Block::writeBack (size_t offset, size_t numBytes) const noexcept
+{
+   #if ! defined (_WIN32)
+    if (! isMapped() || offset >= mSize)
+        return;
+
+    /*
+        The last page is left out unless it is whole, as it may still be
+        being written; the next call starts on that same page again.
+    */
+
+    auto pageSize = getPageSize();
+    auto start = offset / pageSize * pageSize;
+    auto end = std::min (mSize, offset + numBytes) / pageSize * pageSize;
+
+    if (end <= start)
+        return;
+
+   #if defined (__linux__)
+    sync_file_range (mFile, (off_t) start, (off_t) (end - start), SYNC_FILE_RANGE_WRITE);
+   #else
+    msync (static_cast<char*> (mData) + start, end - start, MS_ASYNC);
+   #endif
+   #else
+    (void) offset;
+    (void) numBytes;
+   #endif
+}
+
+//==============================================================================
+DelayMemoryPool& DelayMemoryPool::getInstance()
+{
+    static DelayMemoryPool pool;
+    return pool;
+}
+
+DelayMemoryPool::~DelayMemoryPool()
+{
+    // Every instance should have released its delay lines by now
+    assert (mBytesInUse == 0);
+
+    trim();
+}
+
+size_t DelayMemoryPool::getPageSize() noexcept
+{
+   #if defined (_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo (&info);
+    return (size_t) info.dwPageSize;
+   #else
+    return (size_t) sysconf (_SC_PAGESIZE);
+   #endif
+}
+
+size_t DelayMemoryPool::getGranularity() noexcept
+{
+    // Sizes are rounded up to whole 64kB, so nearly equal requests share blocks
+    return std::max ((size_t) 65536, getPageSize());
+}
+
+void* DelayMemoryPool::allocatePages (size_t numBytes)
+{
+    auto alignment = getPageSize();
+
+   #if defined (_WIN32)
+    return _aligned_malloc (numBytes, alignment);
+   #else
+    void* data = nullptr;
+    return posix_memalign (&data, alignment, numBytes) == 0 ? data : nullptr;
+   #endif
+}
+
+void DelayMemoryPool::freePages (void* data) noexcept
+{
+   #if defined (_WIN32)
+    _aligned_free (data);
+   #else
+    free (data);
+   #endif
+}
+
+void DelayMemoryPool::touchPages (void* data, size_t size) noexcept
+{
+    /*
+        One byte of each page is written; a read would only map the system's
+        shared page of zeros, and the first write would fault all over again.
+        The block isn't cleared anyway, so the byte may as well be a zero.
+    */
+
+    auto pageSize = getPageSize();
+    auto* bytes = static_cast<volatile char*> (data);
+
+    for (size_t offset = 0; offset < size; offset += pageSize)
+        bytes[offset] = 0;
+}
+
+void DelayMemoryPool::unmapFile (void* data, size_t size, int file) noexcept
+{
+   #if ! defined (_WIN32)
+    munmap (data, size);
+    close (file);
+   #else
+    (void) data;
+    (void) size;
+    (void) file;
+   #endif
+}
+
+//==============================================================================
+DelayMemoryPool::Block DelayMemoryPool::allocate (size_t numBytes)
+{
+    /*
+        The smallest cached block that fits is reused, as long as it isn't
+        more than a quarter bigger than asked for; otherwise a small
+        instance could end up holding a big instance's memory.
+    */
+
+    auto granularity = getGranularity();
+    auto size = (std::max ((size_t) 1, numBytes) + granularity - 1) / granularity * granularity;
+
+    {
+        const std::lock_guard<std::mutex> lock (mLock);
+
+        auto found = mCached.lower_bound (size);
+
+        if (found != mCached.end() && found->first <= size + size / 4)
+        {
+            Block block (found->second, found->first);
+
+            mBytesCached -= found->first;
+            mBytesInUse += found->first;
+            mCached.erase (found);
+
+            return block;
+        }
+    }
+
+    auto* data = allocatePages (size);
+
+    if (data == nullptr)
+        return {};
+
+    touchPages (data, size);
+
+    const std::lock_guard<std::mutex> lock (mLock);
+    mBytesInUse += size;
+
+    return Block (data, size);
+}
+
+DelayMemoryPool::Block DelayMemoryPool::allocateMapped (size_t numBytes, const std::string& directory)
+{
+   #if ! defined (_WIN32)
+    if (directory.empty())
+        return {};
+
+    auto granularity = getGranularity();
+    auto size = (std::max ((size_t) 1, numBytes) + granularity - 1) / granularity * granularity;
+
+    auto path = directory + "/TableTennis-XXXXXX";
+    std::vector<char> name (path.begin(), path.end());
+    name.push_back (0);
+
+    auto file = mkstemp (name.data());
+
+    if (file < 0)
+        return {};
+
+    // Nothing else needs to find it, and this way it can't be left behind
+    unlink (name.data());
+
+    // A new file is sparse, and reads as zeros until it is written to
+    if (ftruncate (file, (off_t) size) != 0)
+    {
+        close (file);
+        return {};
+    }
+
+    auto* data = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+    if (data == MAP_FAILED)
+    {
+        close (file);
+        return {};
+    }
+
+    return Block (data, size, file);
+   #else
+    (void) numBytes;
+    (void) directory;
+    return {};
+   #endif
+}
+
+void DelayMemoryPool::release (void* data, size_t size) noexcept
+{
+    {
+        const std::lock_guard<std::mutex> lock (mLock);
+
+        mBytesInUse -= size;
+
+        if (mBytesCached + size <= maxCachedBytes)
+        {
+            mCached.emplace (size, data);
+            mBytesCached += size;
+            return;
+        }
+    }
+
+    freePages (data);
+}
+
+void DelayMemoryPool::trim()
+{
+    std::multimap<size_t, void*> cached;
+
+    {
+        const std::lock_guard<std::mutex> lock (mLock);
+
+        cached.swap (mCached);
+        mBytesCached = 0;
+    }
+
+    for (auto& block : cached)
+        freePages (block.second);
+}
+
+size_t DelayMemoryPool::getBytesInUse() const
+{
+    const std::lock_guard<std::mutex> lock (mLock);
+    return mBytesInUse;
+}
+
+size_t DelayMemoryPool::getBytesCached() const
+{
+    const std::lock_guard<std::mutex> lock (mLock);
+    return mBytesCached;
+}
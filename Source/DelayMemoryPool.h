@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    DelayMemoryPool.h
+
+    Process-wide pool of page-aligned memory for the delay lines.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+//==============================================================================
+/**
+    Every instance of the plug-in in the process gets its delay memory from
+    this one pool, in page-aligned blocks sized for what it actually needs.
+
+    A block fresh from the system has every page touched before it is handed
+    out, so the pages are faulted in there and then, and not the first time
+    the audio thread writes to them. The delay lines are only cleared as they
+    are written, so nothing else would touch them first.
+
+    A block that is handed back (when an instance is released or resized)
+    stays in the pool, still paged in, for the next instance that asks for
+    about the same size. That is the common case when a big session loads,
+    where dozens of instances are prepared one after another at the same
+    rate. Up to maxCachedBytes are kept; anything past that goes straight
+    back to the system.
+
+    allocate() takes a lock and may call the system allocator, so it is for
+    prepareToPlay and the like, never the audio thread. A Block is just a
+    pointer and a size to the audio thread.
+
+    For delays too long to keep in RAM, allocateMapped() gives a block that
+    is a scratch file mapped into memory instead. Its pages are read from and
+    written back to the disk by the system as they are needed, so it is up to
+    whoever owns it to keep the parts the audio thread is about to use paged
+    in (see DelayPager). Mapped blocks are never cached; the file goes away
+    when the block is reset.
+*/
+class DelayMemoryPool
+{
+public:
+    static constexpr size_t maxCachedBytes = (size_t) 256 * 1024 * 1024;
+
+    //==============================================================================
+    /** Memory from the pool, or a mapped file; it is given back when the Block is reset or destroyed. */
+    class Block
+    {
+    public:
+        Block() noexcept = default;
+        ~Block()                                    { reset(); }
+
+        Block (Block&& other) noexcept              { swap (other); }
+        Block& operator= (Block&& other) noexcept   { Block (std::move (other)).swap (*this); return *this; }
+
+        void* getData() const noexcept              { return mData; }
+        size_t getSize() const noexcept             { return mSize; }
+        bool isMapped() const noexcept              { return mFile >= 0; }
+
+        void reset() noexcept;
+
+        /*
+            For mapped blocks only, and both safe to call from any thread
+            while the block is alive; they do nothing for pooled memory.
+
+            prefetch() pages in the bytes from offset onwards, so touching them
+            afterwards doesn't wait for the disk. writeBack() starts writing
+            the ones that have changed out to the file without waiting for it
+            to finish, so the system can later drop them without a stall.
+        */
+
+        void prefetch (size_t offset, size_t numBytes) const noexcept;
+        void writeBack (size_t offset, size_t numBytes) const noexcept;
+
+    private:
+        friend class DelayMemoryPool;
+
+        Block (void* data, size_t size, int file = -1) noexcept : mData (data), mSize (size), mFile (file) {}
+
+        Block (const Block&) = delete;
+        Block& operator= (const Block&) = delete;
+
+        void swap (Block& other) noexcept           { std::swap (mData, other.mData); std::swap (mSize, other.mSize); std::swap (mFile, other.mFile); }
+
+        void* mData = nullptr;
+        size_t mSize = 0;
+        int mFile = -1;                             // The scratch file of a mapped block
+    };
+
+    //==============================================================================
+    static DelayMemoryPool& getInstance();
+
+    /** Not real-time safe. The block is at least numBytes long, page aligned and paged in, but not cleared. */
+    Block allocate (size_t numBytes);
+
+    /**
+        Not real-time safe. Maps a new scratch file in directory of at least
+        numBytes, which starts out as zeros. The file is deleted straight away,
+        so it only lives as long as the mapping, even after a crash. Returns
+        an empty block if the file can't be made, or on Windows.
+    */
+    Block allocateMapped (size_t numBytes, const std::string& directory);
+
+    /** Gives every cached block back to the system. */
+    void trim();
+
+    size_t getBytesInUse() const;
+    size_t getBytesCached() const;
+
+private:
+    DelayMemoryPool() = default;
+    ~DelayMemoryPool();
+
+    DelayMemoryPool (const DelayMemoryPool&) = delete;
+    DelayMemoryPool& operator= (const DelayMemoryPool&) = delete;
+
+    void release (void* data, size_t size) noexcept;
+
+    static size_t getPageSize() noexcept;
+    static size_t getGranularity() noexcept;
+    static void* allocatePages (size_t numBytes);
+    static void freePages (void* data) noexcept;
+    static void touchPages (void* data, size_t size) noexcept;
+    static void unmapFile (void* data, size_t size, int file) noexcept;
+
+    mutable std::mutex mLock;
+    std::multimap<size_t, void*> mCached;   // By size, so a look up finds the best fit
+    size_t mBytesCached = 0;
+    size_t mBytesInUse = 0;
+};
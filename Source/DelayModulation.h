@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    DelayModulation.h
+
+    Wow, flutter and chorus modulation of the delay time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ParameterRamp.h"
+
+//==============================================================================
+/**
+    An LFO that moves the read position of each delay line.
+
+    It runs at the processor's control rate rather than per sample. Every call
+    advances one phase accumulator by a whole sub-block and hands back, for each
+    line, a BlockRamp from where the offset was to where it is now. The kernel
+    already reads gliding delays with the chosen interpolator, so the
+    modulated reads cost no more than any other delay change.
+
+    The waveform is a sine looked up from a table built once, so there is no
+    trig on the audio thread. A sine has no harmonics to alias, so the table
+    is band-limited at any rate. Each line's phase is spread from the first
+    line's to the last's by the phase parameter, so two lines at 90 degrees
+    give the usual stereo chorus.
+
+    Drift swaps some of the sine for a random wander, a new random point once
+    per cycle with a smoothstep between them, for tape-style wow.
+
+    The offset only ever lengthens the delay, from zero up to the depth, so a
+    short delay is never pushed below its own setting.
+
+    The depth glides to each new setting over depthRampSeconds. Taken a tick
+    at a time, a big jump in depth would move the read heads hundreds of
+    samples in one control block, which is heard as a pitch spike rather
+    than as the modulation getting deeper or shallower.
+*/
+class DelayModulator
+{
+public:
+    static constexpr int maxLines = 16;
+    static constexpr double depthRampSeconds = 0.05;
+
+    //==============================================================================
+    void prepare (double sampleRate) noexcept
+    {
+        mSampleRate = sampleRate;
+        mDepth.reset (sampleRate, depthRampSeconds);
+        getSineTable();
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        mPhase = 0.0;
+        mDriftPhase = 0.0;
+        mOffsets.fill (0.f);
+        mDriftFrom.fill (0.f);
+        mDriftTo.fill (0.f);
+
+        // Like the engine's ramps, the depth doesn't glide in from where it was before a reset
+        mDepthNeedsReset = true;
+
+        // Always the same wander after a reset, so an offline render comes out the same every time
+        mRandom.setSeed (0x54546d64);
+    }
+
+    /**
+        rateHz is the LFO speed, depthInSamples the most it adds to a delay,
+        phaseSpread the phase between the first and last lines (0 to 1 of a
+        cycle) and drift how much of the sine is swapped for random wander.
+    */
+    void setParameters (float rateHz, float depthInSamples, float phaseSpread, float drift) noexcept
+    {
+        mIncrement = (double) rateHz / mSampleRate;
+        mPhaseSpread = phaseSpread;
+        mDrift = std::clamp (drift, 0.f, 1.f);
+
+        mDepth.setTargetValue (std::max (0.f, depthInSamples));
+
+        if (mDepthNeedsReset)
+        {
+            mDepth.setCurrentAndTargetValue (mDepth.getTargetValue());
+            mDepthNeedsReset = false;
+        }
+    }
+
+    /** True while there's an offset to apply, including the glide back to none. */
+    bool isActive() const noexcept
+    {
+        if (mDepth.getTargetValue() > 0.f || ! mDepth.isSettled())
+            return true;
+
+        for (auto offset : mOffsets)
+            if (offset != 0.f)
+                return true;
+
+        return false;
+    }
+
+    //==============================================================================
+    /** Advances by numSamples and returns each line's offset ramp, in samples. */
+    void getNextBlock (int numLines, int numSamples, std::array<BlockRamp, maxLines>& offsets) noexcept
+    {
+        assert (numLines <= maxLines);
+
+        mPhase += mIncrement * (double) numSamples;
+        mPhase -= std::floor (mPhase);
+
+        // The drift picks a new random point each time its own phase wraps
+
+        mDriftPhase += mIncrement * (double) numSamples;
+
+        if (mDriftPhase >= 1.0)
+        {
+            mDriftPhase -= std::floor (mDriftPhase);
+
+            for (int line = 0; line < numLines; ++line)
+            {
+                mDriftFrom[(size_t) line] = mDriftTo[(size_t) line];
+                mDriftTo[(size_t) line] = mRandom.nextFloat() * 2.f - 1.f;
+            }
+        }
+
+        auto d = (float) mDriftPhase;
+        auto smooth = d * d * (3.f - 2.f * d);
+
+        auto depth = mDepth.getNextBlock (numSamples).end;
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            auto spread = numLines > 1 ? mPhaseSpread * (float) line / (float) (numLines - 1) : 0.f;
+            auto sine = lookUpSine (mPhase + (double) spread);
+            auto wander = mDriftFrom[(size_t) line] + smooth * (mDriftTo[(size_t) line] - mDriftFrom[(size_t) line]);
+
+            auto lfo = sine + mDrift * (wander - sine);             // -1 to 1
+            auto offset = depth * (lfo + 1.f) * 0.5f;
+
+            offsets[(size_t) line] = { mOffsets[(size_t) line], offset };
+            mOffsets[(size_t) line] = offset;
+        }
+    }
+
+private:
+    //==============================================================================
+    static constexpr int tableSize = 1024;
+
+    using Table = std::array<float, tableSize + 1>;    // One extra point so a lookup never wraps
+
+    static const Table& getSineTable()
+    {
+        static const Table table = []
+        {
+            Table t {};
+
+            for (int i = 0; i <= tableSize; ++i)
+                t[(size_t) i] = (float) std::sin (DspCore::twoPi<double> * (double) i / (double) tableSize);
+
+            return t;
+        }();
+
+        return table;
+    }
+
+    static float lookUpSine (double phase) noexcept
+    {
+        auto& table = getSineTable();
+
+        auto position = (phase - std::floor (phase)) * (double) tableSize;
+        auto index = std::clamp ((int) position, 0, tableSize - 1);
+        auto fraction = (float) (position - (double) index);
+
+        return table[(size_t) index] + fraction * (table[(size_t) index + 1] - table[(size_t) index]);
+    }
+
+    //==============================================================================
+    double mSampleRate = 44100.0;
+    double mPhase = 0.0;
+    double mDriftPhase = 0.0;
+    double mIncrement = 0.0;
+
+    ParameterRamp mDepth;                   // In samples
+    bool mDepthNeedsReset = true;
+    float mPhaseSpread = 0.f;
+    float mDrift = 0.f;
+
+    std::array<float, maxLines> mOffsets {};
+    std::array<float, maxLines> mDriftFrom {};
+    std::array<float, maxLines> mDriftTo {};
+
+    DspCore::Random mRandom;
+};
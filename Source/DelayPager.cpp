@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    DelayPager.cpp
+
+    Background paging for delay lines kept in a mapped scratch file.
+
+  ==============================================================================
+*/
+
+#include "DelayPager.h"
+
+#include <chrono>
+
+//==============================================================================
+void DelayPager::start (std::function<void()> prefetch, std::function<void()> writeBehind)
+{
+    stop();
+
+    {
+        const std::lock_guard<std::mutex> lock (mLock);
+        mStopping = false;
+    }
+
+    mPrefetchThread = std::thread ([this, task = std::move (prefetch)] { run (task); });
+    mWriteBehindThread = std::thread ([this, task = std::move (writeBehind)] { run (task); });
+}
+
+void DelayPager::stop()
+{
+    {
+        const std::lock_guard<std::mutex> lock (mLock);
+        mStopping = true;
+    }
+
+    mWake.notify_all();
+
+    for (auto* thread : { &mPrefetchThread, &mWriteBehindThread })
+        if (thread->joinable())
+            thread->join();
+}
+
+void DelayPager::run (const std::function<void()>& task)
+{
+    std::unique_lock<std::mutex> lock (mLock);
+
+    while (! mStopping)
+    {
+        lock.unlock();
+        task();
+        lock.lock();
+
+        mWake.wait_for (lock, std::chrono::milliseconds (intervalMs), [this] { return mStopping; });
+    }
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    DelayPager.h
+
+    Background paging for delay lines kept in a mapped scratch file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//==============================================================================
+/**
+    Two background threads that look after a circular buffer in a mapped
+    file (see DelayMemoryPool::allocateMapped), so that the audio thread
+    never has to wait for the disk;
+
+        prefetch        pages in what the read and write heads are about to
+                        reach, a little ahead of them
+        write-behind    starts writing out what was just written, so those
+                        pages are clean by the time the system wants them back
+
+    The pager doesn't know anything about the buffer itself. Each thread just
+    calls its task every intervalMs until stop(); the tasks (PingPongKernel's
+    prefetch() and writeBehind()) read where the heads are from atomics the
+    audio thread publishes, so nothing on the audio thread waits on them.
+
+    A page that has been prefetched can still be thrown out again under
+    enough memory pressure; the prefetch comes round again every few
+    milliseconds, long before the heads get there, which keeps that unlikely
+    rather than impossible.
+*/
+class DelayPager
+{
+public:
+    static constexpr int intervalMs = 5;
+
+    DelayPager() = default;
+    ~DelayPager()   { stop(); }
+
+    /** Starts both threads; any that were running are stopped first. Not real-time safe. */
+    void start (std::function<void()> prefetch, std::function<void()> writeBehind);
+
+    /** Stops the threads, waiting for them to finish their current pass. */
+    void stop();
+
+    bool isRunning() const noexcept     { return mPrefetchThread.joinable(); }
+
+private:
+    void run (const std::function<void()>& task);
+
+    DelayPager (const DelayPager&) = delete;
+    DelayPager& operator= (const DelayPager&) = delete;
+
+    std::thread mPrefetchThread;
+    std::thread mWriteBehindThread;
+
+    std::mutex mLock;
+    std::condition_variable mWake;
+    bool mStopping = false;
+};
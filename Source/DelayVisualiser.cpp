@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    DelayVisualiser.cpp
+
+    Live view of the levels and the echo pattern, for the editor.
+
+  ==============================================================================
+*/
+
+#include "DelayVisualiser.h"
+
+namespace
+{
+    constexpr float meterFloorDb = -60.f;
+    constexpr float meterFallOff = 0.8f;           // Per timer tick
+    constexpr float silentLevel = 0.001f;          // Under meterFloorDb, so it shows nothing
+    constexpr int maxRepeats = 8;
+
+    float getMeterProportion (float level) noexcept
+    {
+        auto db = juce::Decibels::gainToDecibels (level, meterFloorDb);
+        return juce::jmap (db, meterFloorDb, 0.f, 0.f, 1.f);
+    }
+}
+
+//==============================================================================
+DelayVisualiser::DelayVisualiser (VisualiserFifo& fifo)
+    : mFifo (fifo)
+{
+    setOpaque (true);
+    startTimerHz (frameRateHz);
+}
+
+DelayVisualiser::~DelayVisualiser()
+{
+    stopTimer();
+}
+
+void DelayVisualiser::timerCallback()
+{
+    /*
+        Takes every frame waiting in the FIFO. The meters jump up to a new
+        peak and fall back by meterFallOff per tick; once they are all
+        resting and the echo pattern hasn't moved, nothing is repainted.
+    */
+
+    VisualiserFrame frame;
+    auto hasFrame = mFifo.popAll (frame);
+    auto hasChanged = false;
+
+    for (size_t line = 0; line < (size_t) VisualiserFrame::maxLines; ++line)
+    {
+        for (auto* levels : { &mInputLevels, &mWetLevels })
+        {
+            auto peak = hasFrame ? (levels == &mInputLevels ? frame.inputPeaks[line] : frame.wetPeaks[line]) : 0.f;
+            auto level = juce::jmax (peak, (*levels)[line] * meterFallOff);
+
+            if (level < silentLevel)
+                level = 0.f;
+
+            hasChanged = hasChanged || level != (*levels)[line];
+            (*levels)[line] = level;
+        }
+    }
+
+    if (hasFrame)
+    {
+        // The peaks now live in the meters, so only the echo pattern is compared
+        frame.inputPeaks.fill (0.f);
+        frame.wetPeaks.fill (0.f);
+
+        hasChanged = hasChanged || frame != mFrame;
+        mFrame = frame;
+    }
+
+    if (hasChanged)
+        repaint();
+}
+
+//==============================================================================
+void DelayVisualiser::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black.withAlpha (0.85f));
+
+    if (mFrame.numLines == 0)
+        return;
+
+    auto area = getLocalBounds().toFloat().reduced (4.f);
+
+    paintMeters (g, area.removeFromLeft (60.f));
+    area.removeFromLeft (6.f);
+    paintEchoes (g, area);
+}
+
+void DelayVisualiser::paintMeters (juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    // Two bars per line, the input in grey and the wet signal in orange
+    auto columnWidth = area.getWidth() / (float) mFrame.numLines;
+
+    for (int line = 0; line < mFrame.numLines; ++line)
+    {
+        auto column = area.removeFromLeft (columnWidth).reduced (0.5f, 0.f);
+        auto input = column.removeFromLeft (column.getWidth() * 0.5f);
+
+        auto inputHeight = input.getHeight() * getMeterProportion (mInputLevels[(size_t) line]);
+        auto wetHeight = column.getHeight() * getMeterProportion (mWetLevels[(size_t) line]);
+
+        g.setColour (juce::Colours::lightgrey);
+        g.fillRect (input.removeFromBottom (inputHeight));
+
+        g.setColour (juce::Colours::orange);
+        g.fillRect (column.removeFromBottom (wetHeight));
+    }
+}
+
+void DelayVisualiser::paintEchoes (juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    /*
+        Follows a hit on the first line round the loop. Every trip it comes
+        out of the line it is in after that line's delay, then the routing
+        moves it on; by the rotation, or into every line at once when a
+        matrix mixes them. In multi-tap mode each trip is drawn as its taps.
+        The dots glow brighter with the wet level of their line.
+    */
+
+    auto numLines = mFrame.numLines;
+    auto laneHeight = area.getHeight() / (float) numLines;
+
+    g.setColour (juce::Colours::white.withAlpha (0.15f));
+
+    for (int lane = 0; lane < numLines; ++lane)
+        g.drawHorizontalLine ((int) (area.getY() + laneHeight * ((float) lane + 0.5f)), area.getX(), area.getRight());
+
+    auto feedback = juce::jlimit (0.f, 0.99f, mFrame.feedback);
+    auto numRepeats = maxRepeats;
+
+    if (feedback < 1.0e-3f)
+        numRepeats = 1;
+    else
+        numRepeats = juce::jlimit (1, maxRepeats, 1 + (int) std::ceil (std::log (0.01f) / std::log (feedback)));
+
+    auto longestMs = 0.f;
+
+    for (int line = 0; line < numLines; ++line)
+        longestMs = juce::jmax (longestMs, mFrame.delaysMs[(size_t) line]);
+
+    auto windowMs = longestMs * (float) numRepeats * 1.05f;
+
+    if (windowMs <= 0.f)
+        return;
+
+    auto drawEcho = [&] (int lane, float timeMs, float gain)
+    {
+        auto x = area.getX() + area.getWidth() * timeMs / windowMs;
+        auto y = area.getY() + laneHeight * ((float) lane + 0.5f);
+        auto radius = juce::jmin (laneHeight * 0.5f, 1.5f + 5.f * std::sqrt (gain));
+        auto glow = 0.35f + 0.65f * getMeterProportion (mWetLevels[(size_t) lane]);
+
+        g.setColour (juce::Colours::orange.withAlpha (glow));
+        g.fillEllipse (x - radius, y - radius, radius * 2.f, radius * 2.f);
+    };
+
+    auto isStraight = mFrame.mode == (int) PingPongKernelBase::Mode::straight;
+    auto isSpread = ! isStraight && mFrame.rotation == 0;
+
+    auto lane = 0;
+    auto timeMs = 0.f;
+    auto gain = 1.f;
+
+    for (int repeat = 0; repeat < numRepeats; ++repeat)
+    {
+        auto delayMs = mFrame.delaysMs[(size_t) lane];
+        auto lanes = isSpread && repeat > 0 ? juce::Range<int> (0, numLines) : juce::Range<int> (lane, lane + 1);
+        auto laneGain = isSpread && repeat > 0 ? gain / std::sqrt ((float) numLines) : gain;
+
+        for (int l = lanes.getStart(); l < lanes.getEnd(); ++l)
+        {
+            if (mFrame.numTaps > 0)
+            {
+                for (int i = 0; i < mFrame.numTaps; ++i)
+                    drawEcho (l, timeMs + delayMs * mFrame.tapScales[(size_t) i], laneGain * mFrame.tapGains[(size_t) i]);
+            }
+            else
+            {
+                drawEcho (l, timeMs + delayMs, laneGain);
+            }
+        }
+
+        timeMs += delayMs;
+        gain *= feedback;
+
+        if (! isStraight && ! isSpread)
+            lane = ((lane - mFrame.rotation) % numLines + numLines) % numLines;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    DelayVisualiser.h
+
+    Live view of the levels and the echo pattern, for the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VisualiserFifo.h"
+
+//==============================================================================
+/**
+    Shows an input and a wet meter for every line, and where the next echoes
+    land; each repeat is a dot on the line it bounces to, sized by how much
+    of it is left after the feedback.
+
+    The frames come from the processor's VisualiserFifo. A timer running at
+    frameRateHz empties the FIFO, and the component only repaints when the
+    picture has actually changed, so a steady delay with no input costs no
+    painting at all. Nothing here ever locks against the audio thread.
+*/
+class DelayVisualiser  : public juce::Component,
+                         private juce::Timer
+{
+public:
+    static constexpr int frameRateHz = 30;
+
+    explicit DelayVisualiser (VisualiserFifo& fifo);
+    ~DelayVisualiser() override;
+
+    void paint (juce::Graphics&) override;
+
+private:
+    void timerCallback() override;
+
+    void paintMeters (juce::Graphics&, juce::Rectangle<float> area) const;
+    void paintEchoes (juce::Graphics&, juce::Rectangle<float> area) const;
+
+    VisualiserFifo& mFifo;
+    VisualiserFrame mFrame;                             // The newest echo pattern
+
+    // The meters fall back gently rather than jumping from frame to frame
+    std::array<float, VisualiserFrame::maxLines> mInputLevels {};
+    std::array<float, VisualiserFrame::maxLines> mWetLevels {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayVisualiser)
+};
@@ -0,0 +1,396 @@
+/*
+  ==============================================================================
+
+    DspCore.h
+
+    The maths and vector helpers that PingPongEngine uses instead of JUCE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if ! defined (DSPCORE_NO_SIMD) && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define DSPCORE_USE_SSE2 1
+ #include <emmintrin.h>
+#elif ! defined (DSPCORE_NO_SIMD) && (defined (__aarch64__) || defined (_M_ARM64))
+ #define DSPCORE_USE_NEON 1
+ #include <arm_neon.h>
+#endif
+
+//==============================================================================
+/**
+    Everything under PingPongEngine (the kernel, the interpolators, the feedback
+    filter and diffuser, the crossover, the ramps, the modulator and the memory
+    pool) only uses the standard library and what is in here, so the engine
+    builds on its own, without JUCE or any other framework.
+
+    The vector operations are written with SimdRegister, which wraps the SSE2
+    registers on x86 and the NEON ones on 64 bit ARM; both are part of every
+    CPU of those kinds, so no extra compiler flags are needed. Compilers won't
+    vectorise plain loops at -O2, and never reorder a float sum on their own,
+    so the reductions keep several accumulators going themselves. Anywhere
+    else (or with DSPCORE_NO_SIMD defined) a register holds a single value and
+    the same code runs as scalar loops. Like juce::FloatVectorOperations, they
+    work on float and double.
+*/
+namespace DspCore
+{
+    template <typename Type>
+    constexpr Type pi = static_cast<Type> (3.141592653589793238L);
+
+    template <typename Type>
+    constexpr Type twoPi = static_cast<Type> (6.283185307179586477L);
+
+    /** The smallest power of two that is at least n. */
+    inline int nextPowerOfTwo (int n) noexcept
+    {
+        auto power = 1;
+
+        while (power < n)
+            power <<= 1;
+
+        return power;
+    }
+
+    //==============================================================================
+    /**
+        One SIMD register of floats or doubles; four floats or two doubles with
+        SSE2 or NEON, or a single value where neither is available. Loads and
+        stores don't need any alignment.
+    */
+    template <typename Type>
+    struct SimdRegister
+    {
+        static constexpr int size = 1;
+
+        Type value;
+
+        template <typename SourceType>
+        static SimdRegister load (const SourceType* source) noexcept        { return { (Type) *source }; }
+        static SimdRegister expand (Type scalar) noexcept                   { return { scalar }; }
+        void store (Type* dest) const noexcept                              { *dest = value; }
+
+        SimdRegister operator+ (SimdRegister other) const noexcept          { return { value + other.value }; }
+        SimdRegister operator- (SimdRegister other) const noexcept          { return { value - other.value }; }
+        SimdRegister operator* (SimdRegister other) const noexcept          { return { value * other.value }; }
+
+        static SimdRegister max (SimdRegister a, SimdRegister b) noexcept   { return { std::max (a.value, b.value) }; }
+        static SimdRegister abs (SimdRegister a) noexcept                   { return { std::abs (a.value) }; }
+        static SimdRegister floor (SimdRegister a) noexcept                 { return { std::floor (a.value) }; }
+    };
+
+   #if DSPCORE_USE_SSE2
+    template <>
+    struct SimdRegister<float>
+    {
+        static constexpr int size = 4;
+
+        __m128 value;
+
+        static SimdRegister load (const float* source) noexcept             { return { _mm_loadu_ps (source) }; }
+        static SimdRegister expand (float scalar) noexcept                  { return { _mm_set1_ps (scalar) }; }
+        void store (float* dest) const noexcept                             { _mm_storeu_ps (dest, value); }
+
+        SimdRegister operator+ (SimdRegister other) const noexcept          { return { _mm_add_ps (value, other.value) }; }
+        SimdRegister operator- (SimdRegister other) const noexcept          { return { _mm_sub_ps (value, other.value) }; }
+        SimdRegister operator* (SimdRegister other) const noexcept          { return { _mm_mul_ps (value, other.value) }; }
+
+        static SimdRegister max (SimdRegister a, SimdRegister b) noexcept   { return { _mm_max_ps (a.value, b.value) }; }
+        static SimdRegister abs (SimdRegister a) noexcept                   { return { _mm_andnot_ps (_mm_set1_ps (-0.f), a.value) }; }
+
+        /** Rounds towards minus infinity; only for values that fit in an int. */
+        static SimdRegister floor (SimdRegister a) noexcept
+        {
+            auto truncated = _mm_cvtepi32_ps (_mm_cvttps_epi32 (a.value));
+            return { _mm_sub_ps (truncated, _mm_and_ps (_mm_cmpgt_ps (truncated, a.value), _mm_set1_ps (1.f))) };
+        }
+    };
+
+    template <>
+    struct SimdRegister<double>
+    {
+        static constexpr int size = 2;
+
+        __m128d value;
+
+        static SimdRegister load (const double* source) noexcept            { return { _mm_loadu_pd (source) }; }
+        static SimdRegister load (const float* source) noexcept             { return { _mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 (reinterpret_cast<const __m128i*> (source)))) }; }
+        static SimdRegister expand (double scalar) noexcept                 { return { _mm_set1_pd (scalar) }; }
+        void store (double* dest) const noexcept                            { _mm_storeu_pd (dest, value); }
+
+        SimdRegister operator+ (SimdRegister other) const noexcept          { return { _mm_add_pd (value, other.value) }; }
+        SimdRegister operator- (SimdRegister other) const noexcept          { return { _mm_sub_pd (value, other.value) }; }
+        SimdRegister operator* (SimdRegister other) const noexcept          { return { _mm_mul_pd (value, other.value) }; }
+
+        static SimdRegister max (SimdRegister a, SimdRegister b) noexcept   { return { _mm_max_pd (a.value, b.value) }; }
+        static SimdRegister abs (SimdRegister a) noexcept                   { return { _mm_andnot_pd (_mm_set1_pd (-0.0), a.value) }; }
+
+        /** Rounds towards minus infinity; only for values that fit in an int. */
+        static SimdRegister floor (SimdRegister a) noexcept
+        {
+            auto truncated = _mm_cvtepi32_pd (_mm_cvttpd_epi32 (a.value));
+            return { _mm_sub_pd (truncated, _mm_and_pd (_mm_cmpgt_pd (truncated, a.value), _mm_set1_pd (1.0))) };
+        }
+    };
+   #elif DSPCORE_USE_NEON
+    template <>
+    struct SimdRegister<float>
+    {
+        static constexpr int size = 4;
+
+        float32x4_t value;
+
+        static SimdRegister load (const float* source) noexcept             { return { vld1q_f32 (source) }; }
+        static SimdRegister expand (float scalar) noexcept                  { return { vdupq_n_f32 (scalar) }; }
+        void store (float* dest) const noexcept                             { vst1q_f32 (dest, value); }
+
+        SimdRegister operator+ (SimdRegister other) const noexcept          { return { vaddq_f32 (value, other.value) }; }
+        SimdRegister operator- (SimdRegister other) const noexcept          { return { vsubq_f32 (value, other.value) }; }
+        SimdRegister operator* (SimdRegister other) const noexcept          { return { vmulq_f32 (value, other.value) }; }
+
+        static SimdRegister max (SimdRegister a, SimdRegister b) noexcept   { return { vmaxq_f32 (a.value, b.value) }; }
+        static SimdRegister abs (SimdRegister a) noexcept                   { return { vabsq_f32 (a.value) }; }
+        static SimdRegister floor (SimdRegister a) noexcept                 { return { vrndmq_f32 (a.value) }; }
+    };
+
+    template <>
+    struct SimdRegister<double>
+    {
+        static constexpr int size = 2;
+
+        float64x2_t value;
+
+        static SimdRegister load (const double* source) noexcept            { return { vld1q_f64 (source) }; }
+        static SimdRegister load (const float* source) noexcept             { return { vcvt_f64_f32 (vld1_f32 (source)) }; }
+        static SimdRegister expand (double scalar) noexcept                 { return { vdupq_n_f64 (scalar) }; }
+        void store (double* dest) const noexcept                            { vst1q_f64 (dest, value); }
+
+        SimdRegister operator+ (SimdRegister other) const noexcept          { return { vaddq_f64 (value, other.value) }; }
+        SimdRegister operator- (SimdRegister other) const noexcept          { return { vsubq_f64 (value, other.value) }; }
+        SimdRegister operator* (SimdRegister other) const noexcept          { return { vmulq_f64 (value, other.value) }; }
+
+        static SimdRegister max (SimdRegister a, SimdRegister b) noexcept   { return { vmaxq_f64 (a.value, b.value) }; }
+        static SimdRegister abs (SimdRegister a) noexcept                   { return { vabsq_f64 (a.value) }; }
+        static SimdRegister floor (SimdRegister a) noexcept                 { return { vrndmq_f64 (a.value) }; }
+    };
+   #endif
+
+    //==============================================================================
+    namespace VectorOps
+    {
+        template <typename Type>
+        void clear (Type* dest, int numSamples) noexcept
+        {
+            std::fill (dest, dest + numSamples, Type());
+        }
+
+        template <typename Type>
+        void copy (Type* dest, const Type* source, int numSamples) noexcept
+        {
+            std::copy (source, source + numSamples, dest);
+        }
+
+        /*
+            Each operation runs a register at a time, and finishes off the
+            last few samples one by one.
+        */
+
+        /** dest += source */
+        template <typename Type>
+        void add (Type* dest, const Type* source, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+                (Register::load (dest + i) + Register::load (source + i)).store (dest + i);
+
+            for (; i < numSamples; ++i)
+                dest[i] += source[i];
+        }
+
+        /** dest -= source */
+        template <typename Type>
+        void subtract (Type* dest, const Type* source, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+                (Register::load (dest + i) - Register::load (source + i)).store (dest + i);
+
+            for (; i < numSamples; ++i)
+                dest[i] -= source[i];
+        }
+
+        /** dest *= source */
+        template <typename Type>
+        void multiply (Type* dest, const Type* source, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+                (Register::load (dest + i) * Register::load (source + i)).store (dest + i);
+
+            for (; i < numSamples; ++i)
+                dest[i] *= source[i];
+        }
+
+        /** dest *= gain */
+        template <typename Type>
+        void multiply (Type* dest, Type gain, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            const auto gains = Register::expand (gain);
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+                (Register::load (dest + i) * gains).store (dest + i);
+
+            for (; i < numSamples; ++i)
+                dest[i] *= gain;
+        }
+
+        /** dest += source * gain */
+        template <typename Type>
+        void addWithMultiply (Type* dest, const Type* source, Type gain, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            const auto gains = Register::expand (gain);
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+                (Register::load (dest + i) + Register::load (source + i) * gains).store (dest + i);
+
+            for (; i < numSamples; ++i)
+                dest[i] += source[i] * gain;
+        }
+
+        /** dest += source * gains */
+        template <typename Type>
+        void addWithMultiply (Type* dest, const Type* source, const Type* gains, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            int i = 0;
+
+            for (; i <= numSamples - Register::size; i += Register::size)
+                (Register::load (dest + i) + Register::load (source + i) * Register::load (gains + i)).store (dest + i);
+
+            for (; i < numSamples; ++i)
+                dest[i] += source[i] * gains[i];
+        }
+
+        /*
+            The reductions keep four registers going, so each one's adds (or
+            maxes) overlap instead of waiting on the one before; that changes
+            the order of a sum, which the compiler isn't allowed to do for us.
+        */
+
+        /** The largest magnitude in the span. */
+        template <typename Type>
+        Type findPeak (const Type* source, int numSamples) noexcept
+        {
+            using Register = SimdRegister<Type>;
+            constexpr int step = 4 * Register::size;
+
+            std::array<Register, 4> peaks;
+            peaks.fill (Register::expand (0));
+
+            int i = 0;
+
+            for (; i <= numSamples - step; i += step)
+                for (int k = 0; k < 4; ++k)
+                    peaks[(size_t) k] = Register::max (peaks[(size_t) k], Register::abs (Register::load (source + i + k * Register::size)));
+
+            auto peak = Register::max (Register::max (peaks[0], peaks[1]), Register::max (peaks[2], peaks[3]));
+
+            std::array<Type, Register::size> values;
+            peak.store (values.data());
+
+            Type result = *std::max_element (values.begin(), values.end());
+
+            for (; i < numSamples; ++i)
+                result = std::max (result, std::abs (source[i]));
+
+            return result;
+        }
+
+        /** The sum of the squares, added up in double precision. */
+        template <typename Type>
+        double sumOfSquares (const Type* source, int numSamples) noexcept
+        {
+            using Register = SimdRegister<double>;
+            constexpr int step = 4 * Register::size;
+
+            std::array<Register, 4> sums;
+            sums.fill (Register::expand (0.0));
+
+            int i = 0;
+
+            for (; i <= numSamples - step; i += step)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    auto x = Register::load (source + i + k * Register::size);
+                    sums[(size_t) k] = sums[(size_t) k] + x * x;
+                }
+            }
+
+            auto total = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+
+            std::array<double, Register::size> values;
+            total.store (values.data());
+
+            auto result = 0.0;
+
+            for (auto value : values)
+                result += value;
+
+            for (; i < numSamples; ++i)
+                result += (double) source[i] * (double) source[i];
+
+            return result;
+        }
+    }
+
+    //==============================================================================
+    /**
+        The same 48 bit linear congruential generator as juce::Random, so a
+        seed gives the same numbers inside the plug-in or out of it.
+    */
+    class Random
+    {
+    public:
+        explicit Random (std::int64_t seed = 1) noexcept : mSeed (seed) {}
+
+        void setSeed (std::int64_t seed) noexcept   { mSeed = seed; }
+
+        int nextInt() noexcept
+        {
+            mSeed = (std::int64_t) ((((std::uint64_t) mSeed) * 0x5deece66dULL + 11) & 0xffffffffffffULL);
+            return (int) (mSeed >> 16);
+        }
+
+        /** Between 0 and 1, never quite reaching 1. */
+        float nextFloat() noexcept
+        {
+            auto result = (float) (std::uint32_t) nextInt() / ((float) std::numeric_limits<std::uint32_t>::max() + 1.f);
+            return std::min (result, 1.f - std::numeric_limits<float>::epsilon());
+        }
+
+    private:
+        std::int64_t mSeed;
+    };
+}
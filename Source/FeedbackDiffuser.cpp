@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+    FeedbackDiffuser.cpp
+
+    Allpass diffusion for the feedback loop of PingPongKernel.
+
+  ==============================================================================
+*/
+
+#include "FeedbackDiffuser.h"
+
+namespace
+{
+    /*
+        The stage lengths, in milliseconds. They don't share any factors, so
+        the smearing doesn't pile up on one period and ring; together they
+        come to under 27ms.
+    */
+
+    constexpr float stageLengthsMs[] = { 1.31f, 1.73f, 2.29f, 2.83f, 3.47f, 4.19f, 4.97f, 5.89f };
+
+    enum ScratchChannel
+    {
+        input = 0,
+        delayed,
+        feedforward,
+        numScratchChannels
+    };
+}
+
+//==============================================================================
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::prepare (double sampleRate, int maximumNumLanes)
+{
+    static_assert (sizeof (stageLengthsMs) / sizeof (stageLengthsMs[0]) == numStages, "One length per stage");
+
+    assert (maximumNumLanes > 0 && maximumNumLanes <= maxLanes);
+
+    mMaximumNumLanes = std::clamp (maximumNumLanes, 1, maxLanes);
+    mLatency = 0;
+
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        mLengths[(size_t) stage] = std::max (1, (int) std::lround (stageLengthsMs[stage] * sampleRate / 1000.0));
+        mLatency += mLengths[(size_t) stage];
+    }
+
+    mChunkLength = *std::min_element (mLengths.begin(), mLengths.end());
+
+    // The longest stage plus a chunk, so a chunk's write never reaches what it reads
+    auto longest = *std::max_element (mLengths.begin(), mLengths.end());
+    mCapacity = DspCore::nextPowerOfTwo (longest + mChunkLength);
+    mMask = mCapacity - 1;
+
+    auto stageSize = (size_t) mCapacity * (size_t) mMaximumNumLanes;
+    auto numBytes = stageSize * (size_t) numStages * sizeof (SampleType);
+
+    if (mMemory.getSize() < numBytes || mMemory.getSize() > 2 * numBytes)
+    {
+        mMemory.reset();
+        mMemory = DelayMemoryPool::getInstance().allocate (numBytes);
+    }
+
+    if (mMemory.getData() == nullptr)
+    {
+        assert (false);     // Out of memory; the kernel carries on without diffusion
+        release();
+        return;
+    }
+
+    for (int stage = 0; stage < numStages; ++stage)
+        mStages[(size_t) stage] = static_cast<SampleType*> (mMemory.getData()) + (size_t) stage * stageSize;
+
+    mScratch.assign ((size_t) numScratchChannels * (size_t) mChunkLength * (size_t) mMaximumNumLanes, SampleType());
+
+    mNumLanes = mMaximumNumLanes;
+    reset();
+}
+
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::release()
+{
+    mMemory.reset();
+    mStages.fill (nullptr);
+    mScratch = {};
+
+    mMaximumNumLanes = mNumLanes = mCapacity = mMask = mChunkLength = mLatency = mWritePosition = 0;
+}
+
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::reset() noexcept
+{
+    for (auto* stage : mStages)
+        if (stage != nullptr)
+            DspCore::VectorOps::clear (stage, mCapacity * mNumLanes);
+
+    mWritePosition = 0;
+}
+
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::setNumLanes (int numLanes) noexcept
+{
+    numLanes = std::clamp (numLanes, 1, std::max (1, mMaximumNumLanes));
+
+    if (numLanes == mNumLanes || ! isPrepared())
+        return;
+
+    mNumLanes = numLanes;
+    reset();
+}
+
+//==============================================================================
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::process (const SampleType* const* source, SampleType* const* dest,
+                                            const BlockRamp& amount, int numSamples) noexcept
+{
+    assert (isPrepared());
+
+    const auto numLanes = mNumLanes;
+    const auto chunkSize = (size_t) mChunkLength * (size_t) numLanes;
+
+    auto* x = mScratch.data() + (size_t) input * chunkSize;
+    auto* d = mScratch.data() + (size_t) delayed * chunkSize;
+    auto* v = mScratch.data() + (size_t) feedforward * chunkSize;
+
+    for (int start = 0; start < numSamples;)
+    {
+        auto numFrames = std::min (mChunkLength, numSamples - start);
+        auto numValues = numFrames * numLanes;
+
+        // The gain is held for each chunk, at the ramp's value half way through it
+        auto gain = (SampleType) (maxGain * std::clamp (amount.getValueAt (((float) start + 0.5f * (float) numFrames) / (float) numSamples), 0.f, 1.f));
+
+        for (int i = 0; i < numFrames; ++i)
+            for (int lane = 0; lane < numLanes; ++lane)
+                x[i * numLanes + lane] = source[lane][start + i];
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            // v = x + g d, y = d - g v
+            readStage (stage, mWritePosition - mLengths[(size_t) stage], d, numFrames);
+
+            DspCore::VectorOps::copy (v, x, numValues);
+            DspCore::VectorOps::addWithMultiply (v, d, gain, numValues);
+
+            writeStage (stage, v, numFrames);
+
+            DspCore::VectorOps::copy (x, d, numValues);
+            DspCore::VectorOps::addWithMultiply (x, v, -gain, numValues);
+        }
+
+        for (int i = 0; i < numFrames; ++i)
+            for (int lane = 0; lane < numLanes; ++lane)
+                dest[lane][start + i] = x[i * numLanes + lane];
+
+        mWritePosition = (mWritePosition + numFrames) & mMask;
+        start += numFrames;
+    }
+}
+
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::readStage (int stage, int startFrame, SampleType* dest, int numFrames) const noexcept
+{
+    auto* buffer = mStages[(size_t) stage];
+
+    startFrame &= mMask;
+
+    auto firstPart = std::min (numFrames, mCapacity - startFrame);
+
+    DspCore::VectorOps::copy (dest, buffer + startFrame * mNumLanes, firstPart * mNumLanes);
+
+    if (firstPart < numFrames)
+        DspCore::VectorOps::copy (dest + firstPart * mNumLanes, buffer, (numFrames - firstPart) * mNumLanes);
+}
+
+template <typename SampleType>
+void FeedbackDiffuser<SampleType>::writeStage (int stage, const SampleType* source, int numFrames) noexcept
+{
+    auto* buffer = mStages[(size_t) stage];
+
+    auto firstPart = std::min (numFrames, mCapacity - mWritePosition);
+
+    DspCore::VectorOps::copy (buffer + mWritePosition * mNumLanes, source, firstPart * mNumLanes);
+
+    if (firstPart < numFrames)
+        DspCore::VectorOps::copy (buffer, source + firstPart * mNumLanes, (numFrames - firstPart) * mNumLanes);
+}
+
+//==============================================================================
+template class FeedbackDiffuser<float>;
+template class FeedbackDiffuser<double>;
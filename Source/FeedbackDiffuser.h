@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    FeedbackDiffuser.h
+
+    Allpass diffusion for the feedback loop of PingPongKernel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DspCore.h"
+#include "ParameterRamp.h"
+#include "DelayMemoryPool.h"
+
+//==============================================================================
+/**
+    A cascade of Schroeder allpass filters that smears each repeat a little
+    more than the one before, so the echoes blur into a reverb-like tail
+    instead of staying as clean copies.
+
+        v[n] = x[n] + g v[n - D]
+        y[n] = v[n - D] - g v[n]
+
+    Each stage only looks D samples back, so as long as a chunk is no longer
+    than the shortest stage every sample it needs is already in the buffer,
+    and a stage is two vector multiply-adds over the whole chunk, like the
+    kernel's spans. The lanes (one per delay line) are interleaved in the
+    stage buffers, so one vector operation covers left and right, or every
+    line there is, as well as the chunk of samples.
+
+    The stages are short and add up to getLatency() samples, which the
+    engine takes off the delay time so the repeats stay on the beat.
+
+    The stage buffers are one block from the DelayMemoryPool, like the
+    delay lines themselves. It doesn't use JUCE.
+*/
+template <typename SampleType>
+class FeedbackDiffuser
+{
+public:
+    static constexpr int numStages = 8;
+    static constexpr int maxLanes = 16;
+    static constexpr float maxGain = 0.7f;     // The allpass gain at a diffusion of 1
+
+    //==============================================================================
+    /** Sizes the stages for this sample rate and takes their memory from the pool. Not real-time safe. */
+    void prepare (double sampleRate, int maximumNumLanes);
+
+    /** Hands the memory back to the pool. */
+    void release();
+
+    /** Clears the stages. */
+    void reset() noexcept;
+
+    /** Changes how many lanes are run, clearing the stages, as their layout changes with it. */
+    void setNumLanes (int numLanes) noexcept;
+
+    bool isPrepared() const noexcept    { return mCapacity > 0; }
+    int getLatency() const noexcept     { return mLatency; }
+
+    /**
+        Diffuses numLanes spans from source into dest, which must be different.
+        The amount goes from 0 to 1 and sets the allpass gain.
+    */
+    void process (const SampleType* const* source, SampleType* const* dest, const BlockRamp& amount, int numSamples) noexcept;
+
+private:
+    //==============================================================================
+    void readStage (int stage, int startFrame, SampleType* dest, int numFrames) const noexcept;
+    void writeStage (int stage, const SampleType* source, int numFrames) noexcept;
+
+    DelayMemoryPool::Block mMemory;
+    std::array<SampleType*, numStages> mStages {};
+    std::array<int, numStages> mLengths {};     // In samples
+
+    std::vector<SampleType> mScratch;           // The chunk, interleaved; input, delayed and v
+
+    int mMaximumNumLanes = 0;
+    int mNumLanes = 0;
+    int mCapacity = 0;                          // Frames in each stage, a power of two
+    int mMask = 0;
+    int mChunkLength = 0;                       // The shortest stage
+    int mLatency = 0;
+    int mWritePosition = 0;
+};
@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+
+    FeedbackFilter.h
+
+    Damping and tone filters for the feedback loop of PingPongKernel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DspCore.h"
+
+//==============================================================================
+/**
+    A high-pass, a low-pass and a tilt EQ, run on the feedback before it is
+    written back into the delay lines, so every repeat gets darker (or thinner)
+    than the one before it.
+
+    The three sections are fused into one loop, one sample at a time for all of
+    the lines. Each line is a lane with its own state, and the lanes sit side
+    by side in DspCore::SimdRegisters (four floats or two doubles to one), so
+    one vector operation steps every line at once. The spans are transposed
+    into that layout a chunk at a time on the way in, and back on the way out.
+
+    Each recursion is also rearranged so that only one multiply and one add
+    stand between a state and its next value (the b coefficients are folded
+    together with the a ones), which is what sets the speed of a filter whose
+    lanes all fit in a register or two. The coefficients are shared by every
+    lane and only change at control ticks.
+
+    A section that is switched off gets pass-through coefficients, and when all
+    three are off the kernel skips the filter altogether.
+*/
+namespace FeedbackFilter
+{
+    static constexpr int maxLanes = 16;
+
+    //==============================================================================
+    /** Transposed direct form II; y = b0 x + s1, s1 = b1 x - a1 y + s2, s2 = b2 x - a2 y. */
+    struct Biquad
+    {
+        float b0 = 1.f, b1 = 0.f, b2 = 0.f, a1 = 0.f, a2 = 0.f;
+    };
+
+    /** First order; y = b0 x + s, s = b1 x - a1 y. */
+    struct FirstOrder
+    {
+        float b0 = 1.f, b1 = 0.f, a1 = 0.f;
+    };
+
+    struct Coefficients
+    {
+        Biquad highPass;
+        Biquad lowPass;
+        FirstOrder tilt;
+
+        bool isActive = false;
+    };
+
+    /** Each state is lane-contiguous, so a register's worth of lanes loads in one go. */
+    template <typename SampleType>
+    struct State
+    {
+        std::array<SampleType, maxLanes> highPass1 {}, highPass2 {};
+        std::array<SampleType, maxLanes> lowPass1 {}, lowPass2 {};
+        std::array<SampleType, maxLanes> tilt {};
+    };
+
+    //==============================================================================
+    // Settings at which each section does nothing
+    static constexpr float lowCutOffHz = 20.f;
+    static constexpr float highCutOffHz = 20000.f;
+
+    /**
+        Works out the coefficients. The biquads are the usual Butterworth (Q of
+        1/sqrt 2) bilinear designs. The tilt is a first order shelf pivoting at
+        1kHz, so a negative tilt darkens the repeats and a positive one thins
+        them out.
+
+        None of the sections ever has a gain above one, as they run inside
+        the loop, where any boost is multiplied by the feedback on every
+        repeat and a high enough feedback would make the echoes grow. So the
+        tilt only ever cuts; a positive tilt takes the lows down by the whole
+        amount and leaves the highs where they were, a negative one the other
+        way round.
+    */
+    inline Coefficients makeCoefficients (double sampleRate, float lowCutHz, float highCutHz, float tiltDb) noexcept
+    {
+        Coefficients c;
+
+        auto nyquistLimit = sampleRate * 0.45;
+        auto q = 1.0 / std::sqrt (2.0);
+
+        if (lowCutHz > lowCutOffHz)
+        {
+            auto w = DspCore::twoPi<double> * std::min ((double) lowCutHz, nyquistLimit) / sampleRate;
+            auto cosW = std::cos (w);
+            auto alpha = std::sin (w) / (2.0 * q);
+            auto a0 = 1.0 + alpha;
+
+            c.highPass = { (float) ((1.0 + cosW) / 2.0 / a0), (float) (-(1.0 + cosW) / a0), (float) ((1.0 + cosW) / 2.0 / a0),
+                           (float) (-2.0 * cosW / a0), (float) ((1.0 - alpha) / a0) };
+            c.isActive = true;
+        }
+
+        if (highCutHz < highCutOffHz && highCutHz < nyquistLimit)
+        {
+            auto w = DspCore::twoPi<double> * (double) highCutHz / sampleRate;
+            auto cosW = std::cos (w);
+            auto alpha = std::sin (w) / (2.0 * q);
+            auto a0 = 1.0 + alpha;
+
+            c.lowPass = { (float) ((1.0 - cosW) / 2.0 / a0), (float) ((1.0 - cosW) / a0), (float) ((1.0 - cosW) / 2.0 / a0),
+                          (float) (-2.0 * cosW / a0), (float) ((1.0 - alpha) / a0) };
+            c.isActive = true;
+        }
+
+        if (tiltDb != 0.f)
+        {
+            /*
+                H(s) = (G s / wc + 1) / (s / wc + 1) goes from 1 at DC to G at the
+                top, centred on wc / sqrt G, so wc is moved up to put that on
+                the pivot. It is then scaled down by the larger of the two, so
+                it peaks at exactly one.
+            */
+
+            auto gain = std::pow (10.0, (double) tiltDb / 20.0);
+            auto cornerHz = std::min (1000.0 * std::sqrt (gain), nyquistLimit);
+            auto k = std::tan (DspCore::pi<double> * cornerHz / sampleRate);
+            auto norm = 1.0 / ((1.0 + k) * std::max (gain, 1.0));
+
+            c.tilt = { (float) ((gain + k) * norm), (float) ((k - gain) * norm), (float) ((k - 1.0) / (1.0 + k)) };
+            c.isActive = true;
+        }
+
+        return c;
+    }
+
+    //==============================================================================
+    namespace Detail
+    {
+        constexpr int chunkLength = 32;
+
+        /*
+            Runs the lanes in numRegisters registers, which hold the whole state
+            between samples. With the b coefficients folded in, a biquad is
+
+                y = b0 x + s1
+                s1 = (s2 + (b1 - a1 b0) x) - a1 s1
+                s2 = (b2 - a2 b0) x - a2 s1
+
+            and the tilt's s = (b1 - a1 b0) x - a1 s likewise; the bracket is
+            worked out off to the side while the state is still on its way.
+        */
+        template <typename SampleType, int numRegisters>
+        void processRegisters (const Coefficients& c, State<SampleType>& state,
+                               const SampleType* const* source, SampleType* const* dest, int numLanes, int numSamples) noexcept
+        {
+            using Register = DspCore::SimdRegister<SampleType>;
+            constexpr int stride = numRegisters * Register::size;
+
+            auto expand = [] (float value) { return Register::expand ((SampleType) value); };
+            auto fold = [] (float b, float a, float b0) { return Register::expand ((SampleType) b - (SampleType) a * (SampleType) b0); };
+
+            const auto hb0 = expand (c.highPass.b0), ha1 = expand (c.highPass.a1), ha2 = expand (c.highPass.a2);
+            const auto hk1 = fold (c.highPass.b1, c.highPass.a1, c.highPass.b0), hk2 = fold (c.highPass.b2, c.highPass.a2, c.highPass.b0);
+            const auto lb0 = expand (c.lowPass.b0), la1 = expand (c.lowPass.a1), la2 = expand (c.lowPass.a2);
+            const auto lk1 = fold (c.lowPass.b1, c.lowPass.a1, c.lowPass.b0), lk2 = fold (c.lowPass.b2, c.lowPass.a2, c.lowPass.b0);
+            const auto tb0 = expand (c.tilt.b0), ta1 = expand (c.tilt.a1), tk1 = fold (c.tilt.b1, c.tilt.a1, c.tilt.b0);
+
+            // Lanes past numLanes only pad out the last register; they start from silence and stay there
+            for (auto* lanes : { &state.highPass1, &state.highPass2, &state.lowPass1, &state.lowPass2, &state.tilt })
+                std::fill (lanes->begin() + numLanes, lanes->begin() + stride, SampleType());
+
+            std::array<Register, numRegisters> hp1, hp2, lp1, lp2, tl;
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                hp1[(size_t) r] = Register::load (state.highPass1.data() + r * Register::size);
+                hp2[(size_t) r] = Register::load (state.highPass2.data() + r * Register::size);
+                lp1[(size_t) r] = Register::load (state.lowPass1.data() + r * Register::size);
+                lp2[(size_t) r] = Register::load (state.lowPass2.data() + r * Register::size);
+                tl[(size_t) r] = Register::load (state.tilt.data() + r * Register::size);
+            }
+
+            // One chunk of every lane, transposed so that sample i's lanes are next to each other
+            SampleType chunk[chunkLength * stride] = {};
+
+            for (int start = 0; start < numSamples; start += chunkLength)
+            {
+                auto length = std::min (chunkLength, numSamples - start);
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    for (int i = 0; i < length; ++i)
+                        chunk[i * stride + lane] = source[lane][start + i];
+
+                for (int i = 0; i < length; ++i)
+                {
+                    for (int r = 0; r < numRegisters; ++r)
+                    {
+                        auto* frame = chunk + i * stride + r * Register::size;
+                        auto x = Register::load (frame);
+
+                        auto h = hb0 * x + hp1[(size_t) r];
+                        auto nextHp1 = (hp2[(size_t) r] + hk1 * x) - ha1 * hp1[(size_t) r];
+                        hp2[(size_t) r] = hk2 * x - ha2 * hp1[(size_t) r];
+                        hp1[(size_t) r] = nextHp1;
+
+                        auto l = lb0 * h + lp1[(size_t) r];
+                        auto nextLp1 = (lp2[(size_t) r] + lk1 * h) - la1 * lp1[(size_t) r];
+                        lp2[(size_t) r] = lk2 * h - la2 * lp1[(size_t) r];
+                        lp1[(size_t) r] = nextLp1;
+
+                        auto t = tb0 * l + tl[(size_t) r];
+                        tl[(size_t) r] = tk1 * l - ta1 * tl[(size_t) r];
+
+                        t.store (frame);
+                    }
+                }
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    for (int i = 0; i < length; ++i)
+                        dest[lane][start + i] = chunk[i * stride + lane];
+            }
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                hp1[(size_t) r].store (state.highPass1.data() + r * Register::size);
+                hp2[(size_t) r].store (state.highPass2.data() + r * Register::size);
+                lp1[(size_t) r].store (state.lowPass1.data() + r * Register::size);
+                lp2[(size_t) r].store (state.lowPass2.data() + r * Register::size);
+                tl[(size_t) r].store (state.tilt.data() + r * Register::size);
+            }
+        }
+
+        /** Picks the fewest registers that hold numLanes, so the register count is known at compile time. */
+        template <typename SampleType, int numRegisters = 1>
+        void processLanes (const Coefficients& c, State<SampleType>& state,
+                           const SampleType* const* source, SampleType* const* dest, int numLanes, int numSamples) noexcept
+        {
+            if constexpr (numRegisters * DspCore::SimdRegister<SampleType>::size < maxLanes)
+            {
+                if (numLanes > numRegisters * DspCore::SimdRegister<SampleType>::size)
+                {
+                    processLanes<SampleType, numRegisters + 1> (c, state, source, dest, numLanes, numSamples);
+                    return;
+                }
+            }
+
+            processRegisters<SampleType, numRegisters> (c, state, source, dest, numLanes, numSamples);
+        }
+    }
+
+    /** Filters numLanes spans from source into dest; they may be the same. */
+    template <typename SampleType>
+    void process (const Coefficients& c, State<SampleType>& state,
+                  const SampleType* const* source, SampleType* const* dest, int numLanes, int numSamples) noexcept
+    {
+        assert (numLanes > 0 && numLanes <= maxLanes);
+
+        Detail::processLanes (c, state, source, dest, numLanes, numSamples);
+    }
+}
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.h
+
+    Per-block parameter smoothing for TableTennisAudioProcessor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DspCore.h"
+
+//==============================================================================
+/**
+    The start and end value of a parameter across one block (or span).
+
+    The kernel turns these into a vector of per-sample values, so a parameter
+    that is not moving costs nothing more than a constant would.
+*/
+struct BlockRamp
+{
+    float start = 0.f;
+    float end = 0.f;
+
+    bool isRamping() const noexcept                     { return start != end; }
+
+    /** The value at a proportion (0 to 1) of the way through the block. */
+    float getValueAt (float proportion) const noexcept  { return start + (end - start) * proportion; }
+
+    /** Fills dest with a straight line from start, stepping towards end. */
+    template <typename SampleType>
+    static void fill (SampleType* dest, float startValue, float step, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = (SampleType) startValue + (SampleType) step * (SampleType) i;
+    }
+};
+
+//==============================================================================
+/**
+    Smooths a parameter towards its target one block at a time.
+
+    Unlike juce::SmoothedValue there is no per-sample getNextValue() call; each
+    block asks for a BlockRamp once and the kernel works out the samples in
+    between with vector operations.
+
+    A linear ramp reaches its target after a fixed time. An exponential ramp is
+    a one-pole lag, which sounds more natural on gain.
+*/
+class ParameterRamp
+{
+public:
+    enum class Shape
+    {
+        linear,
+        exponential
+    };
+
+    explicit ParameterRamp (Shape shape = Shape::linear) noexcept : mShape (shape) {}
+
+    //==============================================================================
+    /** Sets the ramp length (or time constant, for exponential ramps). */
+    void reset (double sampleRate, double rampLengthSeconds) noexcept
+    {
+        mRampLengthSamples = std::max (1, (int) std::lround (sampleRate * rampLengthSeconds));
+        mCoefficient = std::exp (-1.0 / (double) mRampLengthSamples);
+
+        setCurrentAndTargetValue (mTarget);
+    }
+
+    void setCurrentAndTargetValue (float newValue) noexcept
+    {
+        mCurrent = mTarget = newValue;
+        mSamplesLeft = 0;
+    }
+
+    void setTargetValue (float newValue) noexcept
+    {
+        if (newValue == mTarget)
+            return;
+
+        mTarget = newValue;
+
+        if (mShape == Shape::linear)
+        {
+            mSamplesLeft = mRampLengthSamples;
+            mStep = (mTarget - mCurrent) / (float) mSamplesLeft;
+        }
+    }
+
+    float getCurrentValue() const noexcept  { return mCurrent; }
+    float getTargetValue() const noexcept   { return mTarget; }
+
+    /** True once the ramp has reached its target and stopped moving. */
+    bool isSettled() const noexcept         { return mCurrent == mTarget; }
+
+    //==============================================================================
+    /** Advances the ramp by a block and returns where it started and ended. */
+    BlockRamp getNextBlock (int numSamples) noexcept
+    {
+        BlockRamp ramp { mCurrent, mCurrent };
+
+        if (mShape == Shape::linear)
+        {
+            if (mSamplesLeft > 0)
+            {
+                auto steps = std::min (numSamples, mSamplesLeft);
+                mSamplesLeft -= steps;
+                mCurrent = mSamplesLeft > 0 ? mCurrent + mStep * (float) steps : mTarget;
+            }
+        }
+        else if (mCurrent != mTarget)
+        {
+            auto decay = (float) std::pow (mCoefficient, (double) numSamples);
+            mCurrent = mTarget + (mCurrent - mTarget) * decay;
+
+            if (std::abs (mCurrent - mTarget) <= 1.0e-5f * std::max (1.f, std::abs (mTarget)))
+                mCurrent = mTarget;
+        }
+
+        ramp.end = mCurrent;
+        return ramp;
+    }
+
+private:
+    //==============================================================================
+    Shape mShape;
+
+    float mCurrent = 0.f;
+    float mTarget = 0.f;
+    float mStep = 0.f;
+
+    int mRampLengthSamples = 1;
+    int mSamplesLeft = 0;
+    double mCoefficient = 0.0;
+};
@@ -0,0 +1,689 @@
+/*
+  ==============================================================================
+
+    PingPongEngine.cpp
+
+    The whole ping-pong delay behind a plain C++ interface, with no JUCE.
+
+  ==============================================================================
+*/
+
+#include "PingPongEngine.h"
+
+//==============================================================================
+void PingPongEngine::setMaximumDelayTime (float milliseconds) noexcept
+{
+    mMaxDelayMs = std::clamp (milliseconds, 1.f, maxDelayTimeMs + maxOffsetMs);
+}
+
+void PingPongEngine::setMaximumNumBands (int numBands) noexcept
+{
+    mMaxNumBands = std::clamp (numBands, 1, maxBands);
+}
+
+void PingPongEngine::setLongDelayMode (bool shouldBeEnabled, const std::string& scratchDirectory)
+{
+    mLongDelay = shouldBeEnabled;
+    mScratchDirectory = scratchDirectory;
+}
+
+bool PingPongEngine::isUsingScratchFile() const noexcept
+{
+    return std::get<PingPongKernel<float>> (mKernels).isUsingScratchFile()
+        || std::get<PingPongKernel<double>> (mKernels).isUsingScratchFile();
+}
+
+void PingPongEngine::prepare (double sampleRate, int maximumBlockSize, int numChannels, bool useDoublePrecision)
+{
+    /*
+        The kernel needs to initialise its circular buffer, and its scratch
+        space for a whole block. It gets one delay line for every channel of
+        every band, long enough for the longest delay plus the deepest
+        modulation, but only runs the first band's until more are asked for.
+
+        The pager is stopped first, as the lines it looks after are about
+        to be replaced.
+    */
+
+    mPager.stop();
+
+    mSampleRate = sampleRate;
+    mNumChannels = std::clamp (numChannels, 1, maxChannels);
+    mMaximumBlockSize = std::max (1, maximumBlockSize);
+    mPreparedBands = std::clamp (maxChannels / mNumChannels, 1, mMaxNumBands);
+
+    auto numLines = mNumChannels * mPreparedBands;
+
+    /*
+        The split bands are held between the crossover and the kernel, for a
+        block or a control tick, whichever is longer, as that's the longest
+        sub-block processBlock() will hand over in multiband mode.
+    */
+
+    mBandBufferLength = std::max (mMaximumBlockSize, controlBlockSize);
+
+    auto bandBufferSize = mPreparedBands > 1 ? (size_t) (numLines + 2) * (size_t) mBandBufferLength : 0;
+
+    // Only the kernel for the precision asked for gets a buffer
+    if (useDoublePrecision)
+    {
+        getKernel<float>().release();
+        prepareKernel<double> (numLines, maximumBlockSize);
+
+        std::get<std::vector<float>> (mBandBuffers) = {};
+        std::get<std::vector<double>> (mBandBuffers).assign (bandBufferSize, 0.0);
+    }
+    else
+    {
+        getKernel<double>().release();
+        prepareKernel<float> (numLines, maximumBlockSize);
+
+        std::get<std::vector<double>> (mBandBuffers) = {};
+        std::get<std::vector<float>> (mBandBuffers).assign (bandBufferSize, 0.f);
+    }
+
+    mNumBands = 0;
+    setNumBands (1);
+
+    /*
+        The default feedback matrix is a Householder reflection, I - 2/N;
+        every channel feeds all of the others equally and the loop gain
+        stays at one, so the feedback setting alone sets the decay.
+    */
+
+    mHouseholderMatrix.fill (0.f);
+
+    for (int row = 0; row < mNumChannels; ++row)
+        for (int column = 0; column < mNumChannels; ++column)
+            mHouseholderMatrix[(size_t) (row * mNumChannels + column)] = (row == column ? 1.f : 0.f) - 2.f / (float) mNumChannels;
+
+    /*
+        Setting smoothing; the delay time glides a little slower than the
+        gains, so that sweeping it sounds like a tape speed change.
+    */
+
+    for (auto& ramp : mDelayRamps)
+        ramp.reset (sampleRate, 0.2);
+
+    for (auto& ramp : mFeedbackRamps)
+        ramp.reset (sampleRate, 0.05);
+
+    mMixRamp.reset (sampleRate, 0.05);
+    mGainRamp.reset (sampleRate, 0.02);
+    mDiffusionRamp.reset (sampleRate, 0.05);
+    mDiffusionMixRamp.reset (sampleRate, 0.2);
+
+    mFilterNeedsUpdate = true;
+    mModulator.prepare (sampleRate);
+
+    mRampsNeedReset = true;
+    mControlCountdown = 0;
+    mSilentSamples = 0;
+    mSleeping = false;
+}
+
+void PingPongEngine::release()
+{
+    mPager.stop();
+
+    getKernel<float>().release();
+    getKernel<double>().release();
+
+    mBandBuffers = {};
+}
+
+template <typename SampleType>
+void PingPongEngine::prepareKernel (int numLines, int maximumBlockSize)
+{
+    /*
+        The long lines only go in a scratch file. If it can't be made the
+        kernel is prepared again at the usual length, rather than taking
+        minutes of every line from RAM.
+    */
+
+    auto& kernel = getKernel<SampleType>();
+
+    auto getMaxDelayInSamples = [this] (float maxDelayMs)
+    {
+        return std::max (1, (int) std::ceil (mSampleRate * (maxDelayMs + maxModDepthMs) / 1000.0));
+    };
+
+    if (mLongDelay && ! mScratchDirectory.empty())
+        kernel.prepare (numLines, getMaxDelayInSamples (maxLongDelayTimeMs + maxOffsetMs), maximumBlockSize, mScratchDirectory);
+
+    if (! kernel.isUsingScratchFile())
+        kernel.prepare (numLines, getMaxDelayInSamples (mMaxDelayMs), maximumBlockSize);
+
+    kernel.prepareDiffusion (mSampleRate);
+    mDiffusionLatency = kernel.getDiffusionLatency();
+    startPager (kernel);
+}
+
+template <typename SampleType>
+void PingPongEngine::startPager (PingPongKernel<SampleType>& kernel)
+{
+    if (! kernel.isUsingScratchFile())
+        return;
+
+    auto lookahead = (int) std::ceil (mSampleRate * pagerLookaheadSeconds);
+
+    mPager.start ([&kernel, lookahead] { kernel.prefetch (lookahead); },
+                  [&kernel] { kernel.writeBehind(); });
+}
+
+void PingPongEngine::reset() noexcept
+{
+    getKernel<float>().reset();
+    getKernel<double>().reset();
+
+    mCrossoverStates = {};
+    mModulator.reset();
+
+    mRampsNeedReset = true;
+    mControlCountdown = 0;
+    mSilentSamples = 0;
+    mSleeping = false;
+}
+
+//==============================================================================
+double PingPongEngine::getTailLengthSeconds (const Settings& settings) noexcept
+{
+    /*
+        Every trip round the loop multiplies the echo by the feedback, so it
+        takes log(level) / log(feedback) trips to fall to tailDecayDb. Each
+        trip is at most the longest line's delay, modulation included, plus
+        the first one before any feedback happens. In multiband mode the
+        tail is as long as the longest band's.
+    */
+
+    auto longestTailMs = 0.0;
+
+    for (int band = 0; band < std::clamp (settings.numBands, 1, maxBands); ++band)
+    {
+        auto bandSettings = settings.getBand (band);
+        auto longestDelayMs = (double) bandSettings.delayTimeMs + (double) std::max (bandSettings.offsetLMs, bandSettings.offsetRMs)
+                            + (double) settings.modDepthMs;
+        auto feedback = (double) bandSettings.feedback;
+
+        auto numTrips = 1.0;
+
+        if (feedback > 1.0e-6)
+            numTrips += std::ceil (std::log (std::pow (10.0, tailDecayDb / 20.0)) / std::log (feedback));
+
+        longestTailMs = std::max (longestTailMs, numTrips * longestDelayMs);
+    }
+
+    return longestTailMs / 1000.0;
+}
+
+//==============================================================================
+void PingPongEngine::process (float* const* channels, int numSamples, const Meters& meters) noexcept
+{
+    processBlock (channels, numSamples, meters);
+}
+
+void PingPongEngine::process (double* const* channels, int numSamples, const Meters& meters) noexcept
+{
+    processBlock (channels, numSamples, meters);
+}
+
+template <typename SampleType>
+void PingPongEngine::processBlock (SampleType* const* channels, int numSamples, const Meters& meters) noexcept
+{
+    // prepare() hasn't been called for this precision, or ran out of memory
+    if (! isPreparedFor<SampleType>())
+        return;
+
+    /*
+        Sleep; a quiet input only starts the count, the engine keeps
+        running until the tail has had time to die away. Going to sleep
+        clears the kernel, and waking snaps the ramps straight to their
+        targets, so the first sound back starts from a clean buffer.
+
+        While asleep the output is the dry input at the dry gain, the same
+        as the kernel would have made from an empty buffer. The input only
+        counts as quiet when every channel is.
+    */
+
+    auto inputPeak = SampleType();
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+        inputPeak = std::max (inputPeak, DspCore::VectorOps::findPeak (channels[channel], numSamples));
+
+    if (inputPeak > (SampleType) silenceThreshold)
+    {
+        mSilentSamples = 0;
+        mSleeping = false;
+    }
+    else if (! mSleeping)
+    {
+        mSilentSamples += numSamples;
+
+        if ((double) mSilentSamples > getTailLengthSeconds (mSettings) * mSampleRate)
+        {
+            getKernel<SampleType>().reset();
+            mCrossoverStates = {};
+            mSleeping = true;
+            mRampsNeedReset = true;
+            mControlCountdown = 0;
+            mModulator.reset();
+        }
+    }
+
+    if (mSleeping)
+    {
+        auto dryGain = (SampleType) ((1.f - mSettings.mix) * mSettings.gain);
+
+        for (int channel = 0; channel < mNumChannels; ++channel)
+            DspCore::VectorOps::multiply (channels[channel], dryGain, numSamples);
+
+        return;
+    }
+
+    /*
+        The block is split at control ticks, every controlBlockSize samples.
+        At each tick the settings are taken again and the ramps pick up
+        their new targets, so automation is followed every 32 samples
+        whatever size of block comes in, and the exponential gain ramp
+        follows its curve instead of a straight line across a big block.
+
+        When every ramp has settled and nothing has been touched since the
+        last tick, the ticks that follow are joined on to the same
+        sub-block, so a steady block still reaches the kernel in one go
+        and keeps its long vector spans. A moving LFO keeps every tick
+        separate, as its delays change on each one. In multiband mode a
+        sub-block also has to fit in the band buffers.
+    */
+
+    for (int position = 0; position < numSamples;)
+    {
+        if (mControlCountdown == 0)
+        {
+            updateControlTargets();
+            mControlCountdown = controlBlockSize;
+        }
+
+        auto length = std::min (mControlCountdown, numSamples - position);
+        mControlCountdown -= length;
+
+        while (mControlCountdown == 0 && position + length < numSamples
+               && areRampsSettled() && ! mModulator.isActive() && mSettings == mControlSettings)
+        {
+            auto extra = std::min (controlBlockSize, numSamples - position - length);
+
+            if (mNumBands > 1 && length + extra > mBandBufferLength)
+                break;
+
+            length += extra;
+            mControlCountdown = controlBlockSize - extra;
+        }
+
+        processControlBlock (channels, position, length, meters);
+        position += length;
+    }
+}
+
+void PingPongEngine::updateControlTargets() noexcept
+{
+    /*
+        Each line's delay is its band's delay time plus an offset, which are
+        in milliseconds and get converted into samples here. The first
+        channel gets Offset L and the last Offset R, with the ones in between
+        spread evenly from one to the other. With no interpolation they are
+        rounded to whole samples, otherwise the kernel reads between samples
+        with the chosen interpolator.
+    */
+
+    auto& settings = mControlSettings;
+    settings = mSettings;
+
+    auto msToSamples = (float) (mSampleRate / 1000.0);
+
+    /*
+        The diffuser can't delay a repeat by less than its own latency, so
+        while it is on, the delays are floored there rather than the lines
+        being shortened past what they can read.
+    */
+
+    auto diffusion = std::clamp (settings.diffusion, 0.f, 1.f);
+    auto minimumDelay = diffusion > 0.f ? (float) (mDiffusionLatency + DelayInterpolation::maxAfter + 1) : 0.f;
+
+    // Bands that have just come into use start on their settings rather than gliding there
+    auto firstNewBand = maxBands;
+    auto numBands = std::clamp (settings.numBands, 1, mPreparedBands);
+
+    if (numBands != mNumBands)
+    {
+        firstNewBand = mNumBands;
+        setNumBands (numBands);
+    }
+
+    for (int band = 0; band < mNumBands; ++band)
+    {
+        auto bandSettings = settings.getBand (band);
+
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            auto position = mNumChannels > 1 ? (float) channel / (float) (mNumChannels - 1) : 0.f;
+            auto offset = bandSettings.offsetLMs + position * (bandSettings.offsetRMs - bandSettings.offsetLMs);
+            auto delay = std::max ((bandSettings.delayTimeMs + offset) * msToSamples, minimumDelay);
+
+            if (settings.interpolation == DelayInterpolation::Type::none)
+                delay = std::round (delay);
+
+            mDelayRamps[(size_t) (band * mNumChannels + channel)].setTargetValue (delay);
+        }
+
+        mFeedbackRamps[(size_t) band].setTargetValue (bandSettings.feedback);
+    }
+
+    mMixRamp.setTargetValue (settings.mix);
+    mGainRamp.setTargetValue (settings.gain);
+    mDiffusionRamp.setTargetValue (diffusion);
+    mDiffusionMixRamp.setTargetValue (diffusion > 0.f ? 1.f : 0.f);
+
+    if (mRampsNeedReset)
+    {
+        // Nothing to glide from on the first tick after prepare() or a reset
+        for (auto& ramp : mDelayRamps)
+            ramp.setCurrentAndTargetValue (ramp.getTargetValue());
+
+        for (auto& ramp : mFeedbackRamps)
+            ramp.setCurrentAndTargetValue (ramp.getTargetValue());
+
+        for (auto* ramp : { &mMixRamp, &mGainRamp, &mDiffusionRamp, &mDiffusionMixRamp })
+            ramp->setCurrentAndTargetValue (ramp->getTargetValue());
+
+        mRampsNeedReset = false;
+    }
+    else
+    {
+        for (int band = firstNewBand; band < mNumBands; ++band)
+        {
+            for (int channel = 0; channel < mNumChannels; ++channel)
+            {
+                auto& ramp = mDelayRamps[(size_t) (band * mNumChannels + channel)];
+                ramp.setCurrentAndTargetValue (ramp.getTargetValue());
+            }
+
+            mFeedbackRamps[(size_t) band].setCurrentAndTargetValue (mFeedbackRamps[(size_t) band].getTargetValue());
+        }
+    }
+
+    // The diffuser stays in until it has been crossfaded all the way out
+    mDiffusing = mDiffusionMixRamp.getTargetValue() > 0.f || mDiffusionMixRamp.getCurrentValue() > 0.f;
+
+    if (settings.mode == Mode::multiTap)
+        updateTapPattern();
+
+    mModulator.setParameters (settings.modRateHz, settings.modDepthMs * msToSamples, settings.modPhaseDegrees / 360.f, settings.modDrift);
+
+    // The filter only needs new coefficients when one of its settings has moved
+    if (mFilterNeedsUpdate || settings.lowCutHz != mFilterSettings.lowCutHz
+         || settings.highCutHz != mFilterSettings.highCutHz || settings.tiltDb != mFilterSettings.tiltDb)
+    {
+        mFeedbackFilter = FeedbackFilter::makeCoefficients (mSampleRate, settings.lowCutHz, settings.highCutHz, settings.tiltDb);
+        mFilterSettings = settings;
+        mFilterNeedsUpdate = false;
+    }
+
+    if (mNumBands > 1 && (mCrossoverNeedsUpdate || settings.crossoverHz != mCrossoverHz))
+    {
+        mCrossover = Crossover::makeCoefficients (mSampleRate, mNumBands, mNumChannels, settings.crossoverHz);
+        mCrossoverHz = settings.crossoverHz;
+        mCrossoverNeedsUpdate = false;
+    }
+}
+
+void PingPongEngine::setNumBands (int numBands) noexcept
+{
+    /*
+        Changes how many of the kernel's lines are running. A band that comes
+        back starts from an empty line, and the crossover starts again from
+        silence, as its filters are laid out differently for each band count.
+    */
+
+    mNumBands = numBands;
+
+    getKernel<float>().setNumActiveLines (mNumBands * mNumChannels);
+    getKernel<double>().setNumActiveLines (mNumBands * mNumChannels);
+
+    mCrossoverStates = {};
+    mCrossoverNeedsUpdate = true;
+}
+
+void PingPongEngine::updateTapPattern() noexcept
+{
+    /*
+        Builds the multi-tap echo from three settings;
+
+        1. The taps are evenly spaced across the delay time, so the last one
+        lands on the main repeat that feeds back.
+
+        2. Each tap is quieter than the one before it by the decay amount, and
+        the pattern is normalised so the taps add up to the same level
+        whatever their number.
+
+        3. Taps alternate by the spread amount between their own channel and
+        the next one along, so the echoes bounce. With two channels the right
+        line's taps mirror the left's.
+    */
+
+    auto& settings = mControlSettings;
+    auto& taps = mTapPattern;
+
+    taps.numTaps = std::clamp (settings.tapCount, 1, PingPongKernelBase::maxTaps);
+
+    auto gain = 1.f;
+    auto totalGain = 0.f;
+
+    for (int i = 0; i < taps.numTaps; ++i)
+    {
+        auto index = (size_t) i;
+        auto delayScale = (float) (i + 1) / (float) taps.numTaps; // 1
+
+        auto pan = (i % 2 == 0 ? -1.f : 1.f) * settings.tapSpread; // 3, -1 (own channel) to 1 (next channel)
+        auto angle = (pan + 1.f) * DspCore::pi<float> * 0.25f;
+
+        taps.taps[index] = { delayScale, gain * std::cos (angle), gain * std::sin (angle) };
+
+        totalGain += gain;
+        gain *= settings.tapDecay; // 2
+    }
+
+    auto normalise = totalGain > 0.f ? 1.f / totalGain : 0.f;
+
+    for (int i = 0; i < taps.numTaps; ++i)
+    {
+        taps.taps[(size_t) i].gainToSame *= normalise;
+        taps.taps[(size_t) i].gainToNext *= normalise;
+    }
+}
+
+bool PingPongEngine::areRampsSettled() const noexcept
+{
+    for (int line = 0; line < mNumBands * mNumChannels; ++line)
+        if (! mDelayRamps[(size_t) line].isSettled())
+            return false;
+
+    for (int band = 0; band < mNumBands; ++band)
+        if (! mFeedbackRamps[(size_t) band].isSettled())
+            return false;
+
+    return mMixRamp.isSettled() && mGainRamp.isSettled() && mDiffusionRamp.isSettled() && mDiffusionMixRamp.isSettled();
+}
+
+template <typename SampleType>
+void PingPongEngine::processControlBlock (SampleType* const* channels, int startSample, int numSamples, const Meters& meters) noexcept
+{
+    /*
+        The ping-pong itself lives in PingPongKernel, which works on whole
+        spans of the sub-block instead of one sample at a time. The mode
+        picks between the ping-pong, a plain delay on every channel and the
+        multi-tap echo, which all share the same circular buffer.
+
+        Each ramp hands the kernel where its setting starts and ends this
+        sub-block, and the kernel fills in the samples in between. The
+        modulation is added on top of the delay ramps, so the kernel's
+        interpolated read glides the LFO across the sub-block as well.
+
+        In multiband mode the kernel runs every band's lines at once, with
+        the routing kept inside each band; a channel's LFO moves all of its
+        bands together.
+    */
+
+    auto& settings = mControlSettings;
+    auto numLines = mNumBands * mNumChannels;
+
+    std::array<SampleType*, maxChannels> subBlock {};
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+        subBlock[(size_t) channel] = channels[channel] + startSample;
+
+    PingPongKernelBase::Parameters params;
+
+    params.mode = settings.mode;
+    params.interpolation = settings.interpolation;
+    params.routing.rotation = settings.feedbackRotation;
+    params.routing.groupSize = mNumChannels;
+
+    if (settings.useFeedbackMatrix)
+        params.routing.matrix = settings.feedbackMatrix != nullptr ? settings.feedbackMatrix : mHouseholderMatrix.data();
+
+    if (params.mode == Mode::multiTap)
+        params.taps = &mTapPattern;
+
+    params.feedbackFilter = &mFeedbackFilter;
+
+    for (int line = 0; line < numLines; ++line)
+        params.delays[(size_t) line] = mDelayRamps[(size_t) line].getNextBlock (numSamples);
+
+    auto diffusion = mDiffusionRamp.getNextBlock (numSamples);
+    auto diffusionMix = mDiffusionMixRamp.getNextBlock (numSamples);
+
+    if (mDiffusing)
+    {
+        /*
+            The lines are shortened by as much of the latency as the diffuser
+            is faded in, so the repeats glide onto it, like a delay time
+            change, instead of jumping.
+        */
+
+        params.diffusion = diffusion;
+        params.diffusionMix = diffusionMix;
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            params.delays[(size_t) line].start -= diffusionMix.start * (float) mDiffusionLatency;
+            params.delays[(size_t) line].end -= diffusionMix.end * (float) mDiffusionLatency;
+        }
+    }
+
+    if (mModulator.isActive())
+    {
+        std::array<BlockRamp, DelayModulator::maxLines> offsets;
+        mModulator.getNextBlock (mNumChannels, numSamples, offsets);
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            params.delays[(size_t) line].start += offsets[(size_t) (line % mNumChannels)].start;
+            params.delays[(size_t) line].end += offsets[(size_t) (line % mNumChannels)].end;
+        }
+    }
+
+    for (int band = 0; band < mNumBands; ++band)
+    {
+        auto feedback = mFeedbackRamps[(size_t) band].getNextBlock (numSamples);
+
+        for (int channel = 0; channel < mNumChannels; ++channel)
+            params.feedback[(size_t) (band * mNumChannels + channel)] = feedback;
+    }
+
+    params.mix = mMixRamp.getNextBlock (numSamples);
+    params.gain = mGainRamp.getNextBlock (numSamples);
+
+    params.wetPeaks = meters.wetPeaks;
+    params.loopEnergy = meters.loopEnergy;
+
+    if (mNumBands > 1)
+        processBands (subBlock.data(), numSamples, params, meters);
+    else
+        getKernel<SampleType>().process (subBlock.data(), numSamples, params);
+}
+
+template <typename SampleType>
+void PingPongEngine::processBands (SampleType* const* channels, int numSamples, PingPongKernelBase::Parameters& params, const Meters& meters) noexcept
+{
+    /*
+        The multiband ping-pong;
+
+        1. Split every channel into its bands. The input is left as it is.
+
+        2. Run the kernel on all of the bands fully wet, so each band's lines
+        come back holding only its echoes.
+
+        3. Mix the input with the echoes of every band and apply the gain, the
+        same sum the kernel does with one band. The dry signal never goes
+        through the crossover, so it comes out exactly as it went in.
+    */
+
+    auto numLines = mNumBands * mNumChannels;
+    auto length = (size_t) mBandBufferLength;
+    auto* buffer = std::get<std::vector<SampleType>> (mBandBuffers).data();
+
+    std::array<SampleType*, maxChannels> bands {};
+
+    for (int line = 0; line < numLines; ++line)
+        bands[(size_t) line] = buffer + (size_t) line * length;
+
+    Crossover::process (mCrossover, std::get<Crossover::State<SampleType>> (mCrossoverStates), channels, bands.data(), numSamples); // 1
+
+    auto mix = params.mix;
+    auto gain = params.gain;
+
+    params.mix = { 1.f, 1.f };
+    params.gain = { 1.f, 1.f };
+
+    std::array<float, maxChannels> bandPeaks {};
+    params.wetPeaks = meters.wetPeaks != nullptr ? bandPeaks.data() : nullptr;
+
+    getKernel<SampleType>().process (bands.data(), numSamples, params); // 2
+
+    if (mix.isRamping() || gain.isRamping()) // 3
+    {
+        auto* wet = buffer + (size_t) numLines * length;
+        auto* dry = wet + length;
+
+        // wet = mix * gain, dry = (1 - mix) * gain = gain - wet
+        BlockRamp::fill (wet, mix.start,  (mix.end  - mix.start)  / (float) numSamples, numSamples);
+        BlockRamp::fill (dry, gain.start, (gain.end - gain.start) / (float) numSamples, numSamples);
+        DspCore::VectorOps::multiply (wet, dry, numSamples);
+        DspCore::VectorOps::subtract (dry, wet, numSamples);
+
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            DspCore::VectorOps::multiply (channels[channel], dry, numSamples);
+
+            for (int band = 0; band < mNumBands; ++band)
+                DspCore::VectorOps::addWithMultiply (channels[channel], bands[(size_t) (band * mNumChannels + channel)], wet, numSamples);
+        }
+    }
+    else
+    {
+        auto dryGain = (SampleType) ((1.f - mix.start) * gain.start);
+        auto wetGain = (SampleType) (mix.start * gain.start);
+
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            DspCore::VectorOps::multiply (channels[channel], dryGain, numSamples);
+
+            for (int band = 0; band < mNumBands; ++band)
+                DspCore::VectorOps::addWithMultiply (channels[channel], bands[(size_t) (band * mNumChannels + channel)], wetGain, numSamples);
+        }
+    }
+
+    // A channel's wet meter shows its loudest band
+    if (meters.wetPeaks != nullptr)
+        for (int line = 0; line < numLines; ++line)
+            meters.wetPeaks[line % mNumChannels] = std::max (meters.wetPeaks[line % mNumChannels], bandPeaks[(size_t) line]);
+}
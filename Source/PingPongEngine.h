@@ -0,0 +1,377 @@
+/*
+  ==============================================================================
+
+    PingPongEngine.h
+
+    The whole ping-pong delay behind a plain C++ interface, with no JUCE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PingPongKernel.h"
+#include "DelayModulation.h"
+#include "Crossover.h"
+#include "DelayPager.h"
+
+#include <string>
+
+//==============================================================================
+/**
+    Everything TableTennisAudioProcessor does to the audio; parameter
+    smoothing, the control rate, the modulation, the feedback filter, the
+    multi-tap pattern, the multiband split, sleeping through silence and the
+    kernel itself. It only needs the standard library, so it can be built
+    into a program that has nothing to do with JUCE, with PingPongEngine.cpp,
+    PingPongKernel.cpp, FeedbackDiffuser.cpp, DelayMemoryPool.cpp and
+    DelayPager.cpp.
+
+        PingPongEngine engine;
+        engine.prepare (48000.0, 512, 2);
+
+        PingPongEngine::Settings settings;
+        settings.delayTimeMs = 375.f;
+        settings.mix = 0.4f;
+        engine.setSettings (settings);
+
+        engine.process (channels, numSamples);      // In place, float* const*
+
+    prepare() takes all the memory the engine will ever use. After that
+    setSettings() and process() don't allocate, lock or wait, so they are
+    safe on a real-time thread; call them both from that one thread.
+
+    New settings are picked up at the next control tick, every
+    controlBlockSize samples counted from prepare(), and glide there from
+    wherever they were. The output is the same however the audio is split
+    into process() calls.
+
+    The plug-in is a thin wrapper over this; it turns its parameters (and
+    the host's tempo) into Settings, and adds the bypass fade, the metering
+    and the saved state.
+
+    For loops of minutes rather than seconds there is a long delay mode,
+    where the lines are sized for maxLongDelayTimeMs and live in a
+    memory-mapped scratch file on disk instead of RAM. prepare() then also
+    starts a DelayPager, whose threads keep the parts of the file the heads
+    are about to reach paged in, so process() still never waits for the
+    disk.
+*/
+class PingPongEngine
+{
+public:
+    using Mode = PingPongKernelBase::Mode;
+    using TapPattern = PingPongKernelBase::TapPattern;
+    using EnergyMeter = PingPongKernelBase::EnergyMeter;
+
+    static constexpr int maxChannels = PingPongKernelBase::maxChannels;
+    static constexpr int controlBlockSize = 32;
+    static constexpr int maxBands = Crossover::maxBands;
+
+    // Ranges, in milliseconds
+    static constexpr float maxDelayTimeMs = 2000.f;
+    static constexpr float maxOffsetMs = 1000.f;
+    static constexpr float maxModDepthMs = 10.f;
+    static constexpr float maxLongDelayTimeMs = 300000.f;   // Five minutes, in long delay mode
+
+    // How far ahead of the heads the pager keeps a scratch file paged in
+    static constexpr double pagerLookaheadSeconds = 1.0;
+
+    //==============================================================================
+    /** The delay of one band in multiband mode. */
+    struct Band
+    {
+        float delayTimeMs = 250.f;
+        float offsetLMs = 0.f;
+        float offsetRMs = 0.f;
+        float feedback = 0.3f;
+
+        auto tie() const noexcept   { return std::tie (delayTimeMs, offsetLMs, offsetRMs, feedback); }
+
+        bool operator== (const Band& other) const noexcept  { return tie() == other.tie(); }
+        bool operator!= (const Band& other) const noexcept  { return tie() != other.tie(); }
+    };
+
+    struct Settings
+    {
+        float delayTimeMs = 250.f;
+        float offsetLMs = 0.f;      // Added to the first line's delay
+        float offsetRMs = 0.f;      // Added to the last line's; the lines between get a share of both
+        float feedback = 0.3f;      // 0 to just under 1
+        float mix = 0.5f;           // 0 is dry, 1 is wet
+        float gain = 1.f;
+
+        Mode mode = Mode::pingPong;
+        DelayInterpolation::Type interpolation = DelayInterpolation::Type::linear;
+
+        /*
+            Feedback routing; by rotation, or through a numChannels by
+            numChannels matrix, row major, one row per destination. With no
+            matrix given the lines are mixed by a Householder reflection. The
+            matrix isn't copied, so it has to stay put while it is in use.
+        */
+        bool useFeedbackMatrix = false;
+        int feedbackRotation = 1;
+        const float* feedbackMatrix = nullptr;
+
+        int tapCount = 4;           // Multi-tap mode only
+        float tapDecay = 0.7f;
+        float tapSpread = 1.f;
+
+        float lowCutHz = FeedbackFilter::lowCutOffHz;
+        float highCutHz = FeedbackFilter::highCutOffHz;
+        float tiltDb = 0.f;
+
+        float modRateHz = 0.5f;
+        float modDepthMs = 0.f;
+        float modPhaseDegrees = 90.f;
+        float modDrift = 0.f;
+
+        float diffusion = 0.f;      // 0 to 1; smears the repeats into a reverb-like tail, 0 is off
+
+        /*
+            Multiband; with more than one band the input is split at the
+            crossover frequencies (low to high) and every band gets a delay
+            of its own. The first band is the delay time, offsets and
+            feedback above, the others are in upperBands.
+        */
+        int numBands = 1;
+        std::array<float, maxBands - 1> crossoverHz { 250.f, 1500.f, 6000.f };
+        std::array<Band, maxBands - 1> upperBands;
+
+        Band getBand (int band) const noexcept
+        {
+            return band == 0 ? Band { delayTimeMs, offsetLMs, offsetRMs, feedback } : upperBands[(size_t) band - 1];
+        }
+
+        auto tie() const noexcept
+        {
+            return std::tie (delayTimeMs, offsetLMs, offsetRMs, feedback, mix, gain, mode, interpolation,
+                             useFeedbackMatrix, feedbackRotation, feedbackMatrix, tapCount, tapDecay, tapSpread,
+                             lowCutHz, highCutHz, tiltDb, modRateHz, modDepthMs, modPhaseDegrees, modDrift,
+                             diffusion, numBands, crossoverHz, upperBands);
+        }
+
+        bool operator== (const Settings& other) const noexcept  { return tie() == other.tie(); }
+        bool operator!= (const Settings& other) const noexcept  { return tie() != other.tie(); }
+    };
+
+    /** Optional metering, filled in by process(); either pointer may be null. */
+    struct Meters
+    {
+        float* wetPeaks = nullptr;          // One per channel, each max'd with its wet peak
+        EnergyMeter* loopEnergy = nullptr;  // The signal read back out of the lines
+    };
+
+    //==============================================================================
+    /** Sets the longest delay (time plus offset) the lines can hold. Call it before prepare(). */
+    void setMaximumDelayTime (float milliseconds) noexcept;
+    float getMaximumDelayTime() const noexcept      { return mMaxDelayMs; }
+
+    /**
+        Sets how many bands the multiband mode can have, which is how many
+        sets of delay lines prepare() takes. Call it before prepare(); 1 saves
+        the memory when the multiband mode is never going to be used.
+    */
+    void setMaximumNumBands (int numBands) noexcept;
+    int getMaximumNumBands() const noexcept         { return mMaxNumBands; }
+
+    /**
+        Turns the long delay mode on or off; the lines are sized for
+        maxLongDelayTimeMs plus the offsets, rather than getMaximumDelayTime().
+        They are kept in a mapped file made in scratchDirectory, which goes
+        away again on release(). Without one, or if the file can't be made,
+        the lines keep their usual length in RAM, as minutes of every line
+        would be far too much memory; isUsingScratchFile() says which it
+        was. Call it before prepare().
+    */
+    void setLongDelayMode (bool shouldBeEnabled, const std::string& scratchDirectory = {});
+    bool isLongDelayMode() const noexcept           { return mLongDelay; }
+
+    /** True if prepare() put the lines in a scratch file, which is when the long delay mode is running. */
+    bool isUsingScratchFile() const noexcept;
+
+    /**
+        Takes the delay lines and scratch space for this many channels (up
+        to maxChannels) and blocks of up to maximumBlockSize. Only the
+        precision asked for gets any memory. Not real-time safe.
+
+        Each channel gets a line for every band, as long as that fits in
+        maxChannels lines; with more channels there are fewer bands.
+    */
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels, bool useDoublePrecision = false);
+
+    /** Hands the delay lines back; prepare() has to be called again before process(). */
+    void release();
+
+    /** Clears the delay lines, and the next control tick snaps every setting straight to its target. */
+    void reset() noexcept;
+
+    void setSettings (const Settings& newSettings) noexcept     { mSettings = newSettings; }
+
+    /** Picks up the settings at the start of the next process() call instead of the next tick. */
+    void restartControlTick() noexcept                          { mControlCountdown = 0; }
+
+    /** Runs the delay in place on the channels it was prepared for. */
+    void process (float* const* channels, int numSamples, const Meters& meters) noexcept;
+    void process (double* const* channels, int numSamples, const Meters& meters) noexcept;
+
+    void process (float* const* channels, int numSamples) noexcept     { process (channels, numSamples, Meters()); }
+    void process (double* const* channels, int numSamples) noexcept    { process (channels, numSamples, Meters()); }
+
+    //==============================================================================
+    template <typename SampleType>
+    bool isPreparedFor() const noexcept     { return std::get<PingPongKernel<SampleType>> (mKernels).getNumChannels() > 0; }
+
+    double getSampleRate() const noexcept   { return mSampleRate; }
+    int getNumChannels() const noexcept     { return mNumChannels; }
+    int getNumBands() const noexcept        { return mNumBands; }
+
+    /** How long the echoes take to die away, to tailDecayDb, with these settings. */
+    static double getTailLengthSeconds (const Settings& settings) noexcept;
+
+    // Where things are now, for metering and displays
+    const Settings& getControlSettings() const noexcept             { return mControlSettings; }
+    const TapPattern& getTapPattern() const noexcept                { return mTapPattern; }
+    float getCurrentDelayInSamples (int line) const noexcept        { return mDelayRamps[(size_t) line].getCurrentValue(); }
+    float getCurrentFeedback (int band = 0) const noexcept          { return mFeedbackRamps[(size_t) band].getCurrentValue(); }
+    bool isSleeping() const noexcept                                { return mSleeping; }
+
+    /*
+        Silence detection. Once the input has stayed under silenceThreshold for
+        longer than the tail, the feedback has decayed below tailDecayDb and the
+        engine goes to sleep, skipping the kernel until the input comes back.
+    */
+
+    static constexpr float silenceThreshold = 1.0e-5f;     // -100dB
+    static constexpr double tailDecayDb = -90.0;
+
+private:
+    //==============================================================================
+    template <typename SampleType>
+    void processBlock (SampleType* const* channels, int numSamples, const Meters& meters) noexcept;
+
+    template <typename SampleType>
+    void processControlBlock (SampleType* const* channels, int startSample, int numSamples, const Meters& meters) noexcept;
+
+    template <typename SampleType>
+    void processBands (SampleType* const* channels, int numSamples, PingPongKernelBase::Parameters& params, const Meters& meters) noexcept;
+
+    void setNumBands (int numBands) noexcept;
+
+    template <typename SampleType>
+    void prepareKernel (int numLines, int maximumBlockSize);
+
+    template <typename SampleType>
+    void startPager (PingPongKernel<SampleType>& kernel);
+
+    void updateControlTargets() noexcept;
+    void updateTapPattern() noexcept;
+    bool areRampsSettled() const noexcept;
+
+    //==============================================================================
+    double mSampleRate = 44100.0;
+    int mNumChannels = 0;
+    int mMaximumBlockSize = 0;
+
+    /*
+        The lines are sized in prepare() from the sample rate and mMaxDelayMs
+        (plus the deepest modulation), so that 44.1kHz doesn't pay for
+        192kHz worth of memory.
+    */
+
+    float mMaxDelayMs = maxDelayTimeMs + maxOffsetMs;
+
+    /*
+        One kernel per precision, built from the same template. Only the one
+        prepare() asked for is given any memory; the other stays empty.
+    */
+
+    std::tuple<PingPongKernel<float>, PingPongKernel<double>> mKernels;
+
+    template <typename SampleType>
+    PingPongKernel<SampleType>& getKernel() noexcept    { return std::get<PingPongKernel<SampleType>> (mKernels); }
+
+    /*
+        Long delay mode. The pager only runs while a kernel's lines are in
+        a scratch file; it comes after the kernels, so it is stopped before
+        they go.
+    */
+
+    bool mLongDelay = false;
+    std::string mScratchDirectory;
+    DelayPager mPager;
+
+    /*
+        The control rate state. mSettings is what was last asked for and
+        mControlSettings what the ramps are heading for, taken at the last
+        tick. mControlCountdown is how many samples are left until the next.
+    */
+
+    Settings mSettings;
+    Settings mControlSettings;
+    int mControlCountdown = 0;
+
+    /*
+        Ramps that smooth each setting from tick to tick, stopping the zipper
+        noise on automation. The delay ramps are in samples, one per line, and
+        there is a feedback ramp for each band.
+    */
+
+    std::array<ParameterRamp, maxChannels> mDelayRamps;
+    std::array<ParameterRamp, maxBands> mFeedbackRamps;
+    ParameterRamp mMixRamp;
+    ParameterRamp mGainRamp { ParameterRamp::Shape::exponential };
+    ParameterRamp mDiffusionRamp;
+    ParameterRamp mDiffusionMixRamp;    // Crossfades the diffuser in and out, 0 or 1
+
+    bool mRampsNeedReset = true;
+
+    // The multi-tap echo's taps, rebuilt from the tap settings each tick
+    TapPattern mTapPattern;
+
+    // The feedback filter's coefficients, and the settings they were made from
+    FeedbackFilter::Coefficients mFeedbackFilter;
+    Settings mFilterSettings;
+    bool mFilterNeedsUpdate = true;
+
+    /*
+        The diffuser delays every repeat by mDiffusionLatency samples, so
+        while it is on (or still fading out) the lines are read that much
+        sooner and the echoes stay where the delay time puts them. The
+        offset follows mDiffusionMixRamp, so it glides in and out.
+    */
+
+    int mDiffusionLatency = 0;
+    bool mDiffusing = false;
+
+    // The delay time LFO, stepped once per control sub-block
+    DelayModulator mModulator;
+
+    /*
+        Multiband. The kernel gets a line for every band of every channel,
+        band after band, and routes each band's lines only among themselves,
+        so every band is its own ping-pong; they are all run together, span
+        by span, in one pass of the kernel. mBandBuffers holds the split
+        bands while they go through it, plus two channels for the dry and
+        wet gains, in the precision that was prepared.
+    */
+
+    int mMaxNumBands = maxBands;
+    int mPreparedBands = 1;
+    int mNumBands = 1;
+
+    Crossover::Coefficients mCrossover;
+    std::array<float, maxBands - 1> mCrossoverHz {};
+    bool mCrossoverNeedsUpdate = true;
+
+    std::tuple<Crossover::State<float>, Crossover::State<double>> mCrossoverStates;
+    std::tuple<std::vector<float>, std::vector<double>> mBandBuffers;
+    int mBandBufferLength = 0;
+
+    // The default feedback matrix, built for the channel count in prepare()
+    std::array<float, maxChannels * maxChannels> mHouseholderMatrix {};
+
+    std::int64_t mSilentSamples = 0;
+    bool mSleeping = false;
+};
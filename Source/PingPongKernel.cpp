@@ -0,0 +1,921 @@
+/*
+  ==============================================================================
+
+    PingPongKernel.cpp
+
+    Block based ping-pong delay kernel used by TableTennisAudioProcessor.
+
+  ==============================================================================
+*/
+
+#include "PingPongKernel.h"
+
+namespace
+{
+    /*
+        Channels of the scratch buffer; five per line (the delayed span, the
+        routed feedback, the multi-tap wet signal, the filtered feedback and
+        the diffused feedback) followed by the shared ones.
+    */
+
+    int getDelayedChannel (int line) noexcept                   { return line; }
+    int getRoutedChannel (int line, int numLines) noexcept      { return numLines + line; }
+    int getTapWetChannel (int line, int numLines) noexcept      { return 2 * numLines + line; }
+    int getFilteredChannel (int line, int numLines) noexcept    { return 3 * numLines + line; }
+    int getDiffusedChannel (int line, int numLines) noexcept    { return 4 * numLines + line; }
+
+    enum SharedScratchChannel
+    {
+        feedbackGains = 0,
+        wetGains,
+        dryGains,
+        tapSpan,
+        window,
+        numSharedScratchChannels
+    };
+
+    int getSharedChannel (SharedScratchChannel channel, int numLines) noexcept  { return 5 * numLines + (int) channel; }
+
+    /*
+        The interpolators look a few samples either side of the read position,
+        so the window they read from is a little longer than a span.
+    */
+
+    constexpr int windowMargin = DelayInterpolation::maxBefore + DelayInterpolation::maxAfter + 1;
+
+    /** The part of a block ramp that covers samples [start, start + length). */
+    BlockRamp getSubRamp (const BlockRamp& ramp, int start, int length, int total) noexcept
+    {
+        if (! ramp.isRamping())
+            return ramp;
+
+        return { ramp.getValueAt ((float) start / (float) total),
+                 ramp.getValueAt ((float) (start + length) / (float) total) };
+    }
+
+    BlockRamp clampRamp (const BlockRamp& ramp, float minimum, float maximum) noexcept
+    {
+        return { std::clamp (ramp.start, minimum, maximum),
+                 std::clamp (ramp.end, minimum, maximum) };
+    }
+
+    BlockRamp scaleRamp (const BlockRamp& ramp, float scale) noexcept
+    {
+        return { ramp.start * scale, ramp.end * scale };
+    }
+
+    bool isWholeSample (float delay) noexcept
+    {
+        return delay == std::floor (delay);
+    }
+
+    /**
+        Keeps a delay inside the buffer. A whole sample delay is a plain copy and
+        can go down to one sample, but an interpolated one can't read samples
+        that haven't been written yet.
+    */
+    template <typename Interpolator>
+    BlockRamp clampDelay (const BlockRamp& delay, int maximumDelay) noexcept
+    {
+        auto isCopy = ! delay.isRamping() && isWholeSample (delay.start);
+        auto minimum = isCopy ? 1.f : (float) (Interpolator::after + 1);
+
+        return clampRamp (delay, minimum, (float) maximumDelay);
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void PingPongKernel<SampleType>::prepare (int numChannels, int maximumDelayInSamples, int maximumBlockSize, const std::string& scratchDirectory)
+{
+    assert (numChannels > 0 && numChannels <= maxChannels);
+    assert (maximumDelayInSamples > 0 && maximumBlockSize > 0);
+
+    /*
+        One extra slot means the oldest sample we may read (maximum delay)
+        is never the slot being written in the same span, and the window
+        margin leaves room for the samples an interpolator reads around it.
+        That is rounded up to a power of two, so indices wrap with a mask.
+    */
+
+    mNumChannels = mNumPreparedLines = std::clamp (numChannels, 1, maxChannels);
+    mMaximumDelay = maximumDelayInSamples;
+    mMaximumBlockSize = maximumBlockSize;
+    mCapacity = DspCore::nextPowerOfTwo (maximumDelayInSamples + 1 + windowMargin);
+    mMask = mCapacity - 1;
+
+    /*
+        Each line starts on a cache line boundary. The pooled block is kept
+        if it is big enough and not more than twice what is needed now, so
+        preparing again at the same settings doesn't touch the pool. A
+        scratch file is made afresh every time, as it starts out silent.
+    */
+
+    constexpr int samplesPerCacheLine = 64 / (int) sizeof (SampleType);
+
+    auto lineStride = (mCapacity + samplesPerCacheLine - 1) / samplesPerCacheLine * samplesPerCacheLine;
+    auto numBytes = (size_t) lineStride * (size_t) mNumChannels * sizeof (SampleType);
+    auto useScratchFile = ! scratchDirectory.empty();
+
+    if (mMemory.getSize() < numBytes || mMemory.getSize() > 2 * numBytes || mMemory.isMapped() || useScratchFile)
+    {
+        mMemory.reset();
+
+        mMemory = useScratchFile ? DelayMemoryPool::getInstance().allocateMapped (numBytes, scratchDirectory)
+                                 : DelayMemoryPool::getInstance().allocate (numBytes);
+    }
+
+    if (mMemory.getData() == nullptr)
+    {
+        /*
+            Out of memory, or the scratch file couldn't be made; the kernel
+            stays unprepared, and the engine either prepares it again without
+            the file or passes audio through.
+        */
+
+        assert (useScratchFile);
+        release();
+        return;
+    }
+
+    mLines.fill (nullptr);
+
+    for (int line = 0; line < mNumChannels; ++line)
+        mLines[(size_t) line] = static_cast<SampleType*> (mMemory.getData()) + (size_t) line * (size_t) lineStride;
+
+    mWritten.fill (0);
+    mHeads.reset();
+    mWrittenBackPosition = 0;
+
+    if (mMemory.isMapped())
+    {
+        mHeads = std::make_unique<PublishedHeads>();
+
+        for (auto& delay : mHeads->delays)
+            delay.store (-1, std::memory_order_relaxed);
+    }
+
+    mScratchLength = maximumBlockSize + windowMargin;
+    mScratch.assign ((size_t) (5 * mNumChannels + numSharedScratchChannels) * (size_t) mScratchLength, SampleType());
+
+    // Builds the sinc table here, rather than on the audio thread
+    DelayInterpolation::WindowedSinc::getTable();
+
+    reset();
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::reset() noexcept
+{
+    mWritePosition = 0;
+
+    // Only the active lines; the others are cleared when they come back into use
+    for (int line = 0; line < mNumChannels; ++line)
+        clearSamples (line);
+
+    std::fill (mScratch.begin(), mScratch.end(), SampleType());
+    mReadHeadState.fill (SampleType());
+    mFilterState = {};
+    mDiffuser.reset();
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::setNumActiveLines (int numLines) noexcept
+{
+    if (mNumPreparedLines == 0)
+        return;
+
+    numLines = std::clamp (numLines, 1, mNumPreparedLines);
+
+    for (int line = mNumChannels; line < numLines; ++line)
+        clearLine (line);
+
+    mNumChannels = numLines;
+    mDiffuser.setNumLanes (numLines);
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::clearLine (int line) noexcept
+{
+    /*
+        Everything a line carries from one span to the next; its samples, the
+        interpolator state of its read heads and its lane of the filter.
+    */
+
+    clearSamples (line);
+
+    mReadHeadState[(size_t) getReadHead (line)] = SampleType();
+
+    for (int tap = 0; tap < maxTaps; ++tap)
+        mReadHeadState[(size_t) getTapReadHead (line, tap)] = SampleType();
+
+    for (auto* lane : { &mFilterState.highPass1, &mFilterState.highPass2, &mFilterState.lowPass1,
+                        &mFilterState.lowPass2, &mFilterState.tilt })
+        (*lane)[(size_t) line] = SampleType();
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::clearSamples (int line) noexcept
+{
+    /*
+        Clearing a whole line is far too slow for the audio thread (and a
+        scratch file would have to be paged through), so it is just
+        forgotten instead, apart from a window's worth of samples behind the
+        write position. Reads that reach over the edge of what has been
+        written since then find silence there, as they would in a cleared
+        line, and those entirely past it aren't made at all.
+    */
+
+    auto* samples = mLines[(size_t) line];
+
+    for (int i = 1; i <= windowMargin + 1; ++i)
+        samples[(mWritePosition - i) & mMask] = SampleType();
+
+    mWritten[(size_t) line] = 0;
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::prepareDiffusion (double sampleRate)
+{
+    if (mNumPreparedLines == 0)
+        return;
+
+    mDiffuser.prepare (sampleRate, mNumPreparedLines);
+    mDiffuser.setNumLanes (mNumChannels);
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::release()
+{
+    mMemory.reset();
+    mDiffuser.release();
+    mLines.fill (nullptr);
+    mScratch = {};
+    mHeads.reset();
+
+    mNumChannels = mNumPreparedLines = mScratchLength = mCapacity = mMask = mMaximumDelay = mMaximumBlockSize = mWritePosition = 0;
+}
+
+//==============================================================================
+template <typename SampleType>
+void PingPongKernel<SampleType>::process (SampleType* const* channels, int numSamples, const Parameters& params) noexcept
+{
+    assert (mCapacity > 0);
+
+    // The interpolator is picked once here, for the whole block
+
+    switch (params.interpolation)
+    {
+        case DelayInterpolation::Type::none:          processWith<DelayInterpolation::None>         (channels, numSamples, params); break;
+        case DelayInterpolation::Type::linear:        processWith<DelayInterpolation::Linear>       (channels, numSamples, params); break;
+        case DelayInterpolation::Type::lagrange3rd:   processWith<DelayInterpolation::Lagrange3rd>  (channels, numSamples, params); break;
+        case DelayInterpolation::Type::thiran:        processWith<DelayInterpolation::Thiran>       (channels, numSamples, params); break;
+        case DelayInterpolation::Type::windowedSinc:  processWith<DelayInterpolation::WindowedSinc> (channels, numSamples, params); break;
+        default:                                      assert (false); break;
+    }
+}
+
+template <typename SampleType>
+template <typename Interpolator>
+void PingPongKernel<SampleType>::processWith (SampleType* const* channels, int numSamples, const Parameters& params) noexcept
+{
+    Parameters clamped = params;
+
+    for (int line = 0; line < mNumChannels; ++line)
+        clamped.delays[(size_t) line] = clampDelay<Interpolator> (params.delays[(size_t) line], mMaximumDelay);
+
+    /*
+        A span may never be longer than the shortest delay, otherwise it would
+        read samples that the same span is about to write. An interpolated read
+        reaches a few samples further forward, so its spans are a little shorter.
+
+        It also can't be longer than the scratch buffer, in case the host sends
+        a bigger block than it promised in prepareToPlay.
+    */
+
+    auto maxSpan = mMaximumBlockSize;
+
+    for (int line = 0; line < mNumChannels; ++line)
+    {
+        auto& delay = clamped.delays[(size_t) line];
+
+        maxSpan = std::min (maxSpan, getMaximumSpan<Interpolator> (delay));
+
+        if (clamped.mode == Mode::multiTap && clamped.taps != nullptr)
+            for (int i = 0; i < clamped.taps->numTaps; ++i)
+                maxSpan = std::min (maxSpan, getMaximumSpan<Interpolator> (clampDelay<Interpolator> (scaleRamp (delay, clamped.taps->taps[(size_t) i].delayScale), mMaximumDelay)));
+    }
+
+    std::array<SampleType*, maxChannels> spanChannels {};
+
+    for (int start = 0; start < numSamples;)
+    {
+        auto spanLength = std::min (maxSpan, numSamples - start);
+
+        auto spanParams = clamped;
+
+        for (int line = 0; line < mNumChannels; ++line)
+        {
+            spanParams.delays[(size_t) line] = getSubRamp (clamped.delays[(size_t) line], start, spanLength, numSamples);
+            spanParams.feedback[(size_t) line] = getSubRamp (clamped.feedback[(size_t) line], start, spanLength, numSamples);
+            spanChannels[(size_t) line] = channels[line] + start;
+        }
+
+        spanParams.diffusion = getSubRamp (clamped.diffusion, start, spanLength, numSamples);
+        spanParams.diffusionMix = getSubRamp (clamped.diffusionMix, start, spanLength, numSamples);
+        spanParams.mix      = getSubRamp (clamped.mix,      start, spanLength, numSamples);
+        spanParams.gain     = getSubRamp (clamped.gain,     start, spanLength, numSamples);
+
+        processSpan<Interpolator> (spanChannels.data(), spanLength, spanParams);
+        start += spanLength;
+    }
+
+    if (mHeads != nullptr)
+        publishHeads (clamped);
+}
+
+template <typename SampleType>
+template <typename Interpolator>
+int PingPongKernel<SampleType>::getMaximumSpan (const BlockRamp& delay) const noexcept
+{
+    if (! delay.isRamping())
+    {
+        if (std::is_same<Interpolator, DelayInterpolation::None>::value || isWholeSample (delay.start))
+            return std::max (1, (int) std::lround (delay.start));
+
+        return std::max (1, (int) delay.start - Interpolator::after + 1);
+    }
+
+    return std::max (1, (int) std::min (delay.start, delay.end) - Interpolator::after);
+}
+
+template <typename SampleType>
+template <typename Interpolator>
+void PingPongKernel<SampleType>::processSpan (SampleType* const* channels, int numSamples, const Parameters& params) noexcept
+{
+    /*
+        This is the same ping-pong as the old per-sample loop, one span at a time;
+
+        1. Read every line's delayed span, and any taps. Everything is read before
+        the span is written, as the write may land on the oldest samples.
+
+        2. Route the delayed spans between the lines; this is the bounce.
+        The routed spans go through the diffuser, if it is on, and then the
+        feedback filter, if there is one.
+
+        3. Write each channel's input plus its routed feedback into its line.
+
+        4. Mix the dry input with the wet signal and apply the gain, in place.
+
+        Any parameter that is ramping is turned into a vector of gains first.
+    */
+
+    for (int line = 0; line < mNumChannels; ++line) // 1
+        readSpan<Interpolator> (line, params.delays[(size_t) line], getScratch (getDelayedChannel (line)),
+                                numSamples, mReadHeadState[(size_t) getReadHead (line)]);
+
+    if (params.loopEnergy != nullptr)
+    {
+        for (int line = 0; line < mNumChannels; ++line)
+            params.loopEnergy->sumOfSquares += DspCore::VectorOps::sumOfSquares (getScratch (getDelayedChannel (line)), numSamples);
+
+        params.loopEnergy->numSamples += (std::int64_t) numSamples * mNumChannels;
+    }
+
+    routeFeedback (params, numSamples); // 2
+
+    /*
+        The diffuser starts from silence each time it is switched on, rather
+        than replaying what it held last time. It is faded in from nothing, so
+        that silence is never heard on its own.
+    */
+
+    auto diffuse = (params.diffusionMix.start > 0.f || params.diffusionMix.end > 0.f) && mDiffuser.isPrepared();
+
+    if (diffuse && ! mDiffusing)
+        mDiffuser.reset();
+
+    mDiffusing = diffuse;
+
+    if (diffuse)
+        diffuseFeedback (params.diffusion, params.diffusionMix, numSamples);
+
+    mWet = mRouted;
+    mFeedback = mRouted;
+
+    if (params.feedbackFilter != nullptr && params.feedbackFilter->isActive)
+        filterFeedback (*params.feedbackFilter, numSamples);
+
+    if (params.mode == Mode::multiTap && params.taps != nullptr)
+        accumulateTaps<Interpolator> (*params.taps, params, numSamples);
+
+    for (int line = 0; line < mNumChannels; ++line) // 3
+    {
+        auto& feedback = params.feedback[(size_t) line];
+        const SampleType* feedbackRamp = nullptr;
+
+        if (feedback.isRamping())
+        {
+            auto* gains = getScratch (getSharedChannel (feedbackGains, mNumChannels));
+            BlockRamp::fill (gains, feedback.start, (feedback.end - feedback.start) / (float) numSamples, numSamples);
+            feedbackRamp = gains;
+        }
+
+        writeSpan (line, channels[line], mFeedback[(size_t) line], feedbackRamp, (SampleType) feedback.start, numSamples);
+    }
+
+    if (params.mix.isRamping() || params.gain.isRamping()) // 4
+    {
+        auto* wet = getScratch (getSharedChannel (wetGains, mNumChannels));
+        auto* dry = getScratch (getSharedChannel (dryGains, mNumChannels));
+
+        // wet = mix * gain, dry = (1 - mix) * gain = gain - wet
+        BlockRamp::fill (wet, params.mix.start,  (params.mix.end  - params.mix.start)  / (float) numSamples, numSamples);
+        BlockRamp::fill (dry, params.gain.start, (params.gain.end - params.gain.start) / (float) numSamples, numSamples);
+        DspCore::VectorOps::multiply (wet, dry, numSamples);
+        DspCore::VectorOps::subtract (dry, wet, numSamples);
+
+        for (int ch = 0; ch < mNumChannels; ++ch)
+        {
+            DspCore::VectorOps::multiply (channels[ch], dry, numSamples);
+            DspCore::VectorOps::addWithMultiply (channels[ch], mWet[(size_t) ch], wet, numSamples);
+        }
+    }
+    else
+    {
+        auto dryGain = (SampleType) ((1.f - params.mix.start) * params.gain.start);
+        auto wetGain = (SampleType) (params.mix.start * params.gain.start);
+
+        // Fully wet, as the multiband mode runs every band, the dry signal needn't be touched
+        if (dryGain == SampleType() && wetGain == SampleType (1))
+        {
+            for (int ch = 0; ch < mNumChannels; ++ch)
+                DspCore::VectorOps::copy (channels[ch], mWet[(size_t) ch], numSamples);
+        }
+        else
+        {
+            for (int ch = 0; ch < mNumChannels; ++ch)
+            {
+                DspCore::VectorOps::multiply (channels[ch], dryGain, numSamples);
+                DspCore::VectorOps::addWithMultiply (channels[ch], mWet[(size_t) ch], wetGain, numSamples);
+            }
+        }
+    }
+
+    if (params.wetPeaks != nullptr)
+    {
+        for (int line = 0; line < mNumChannels; ++line)
+        {
+            auto peak = (float) DspCore::VectorOps::findPeak (mWet[(size_t) line], numSamples);
+            params.wetPeaks[line] = std::max (params.wetPeaks[line], peak);
+        }
+    }
+
+    mWritePosition = (mWritePosition + numSamples) & mMask;
+
+    for (int line = 0; line < mNumChannels; ++line)
+        mWritten[(size_t) line] = std::min (mCapacity, mWritten[(size_t) line] + numSamples);
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::routeFeedback (const Parameters& params, int numSamples) noexcept
+{
+    /*
+        A straight delay and a rotation only pick which line's span each line
+        gets, so nothing is copied. A matrix mixes whole spans together, one
+        vector multiply-add for each non-zero entry.
+    */
+
+    if (params.mode == Mode::straight)
+    {
+        for (int line = 0; line < mNumChannels; ++line)
+            mRouted[(size_t) line] = getScratch (getDelayedChannel (line));
+
+        return;
+    }
+
+    auto groupSize = getGroupSize (params.routing, mNumChannels);
+
+    if (params.routing.matrix == nullptr)
+    {
+        auto rotation = params.routing.rotation % groupSize;
+
+        if (rotation < 0)
+            rotation += groupSize;
+
+        for (int line = 0; line < mNumChannels; ++line)
+        {
+            auto group = line - line % groupSize;
+            mRouted[(size_t) line] = getScratch (getDelayedChannel (group + (line - group + rotation) % groupSize));
+        }
+
+        return;
+    }
+
+    for (int line = 0; line < mNumChannels; ++line)
+    {
+        auto* dest = getScratch (getRoutedChannel (line, mNumChannels));
+        auto group = line - line % groupSize;
+        auto* row = params.routing.matrix + (line - group) * groupSize;
+
+        DspCore::VectorOps::clear (dest, numSamples);
+
+        for (int source = 0; source < groupSize; ++source)
+            if (row[source] != 0.f)
+                DspCore::VectorOps::addWithMultiply (dest, getScratch (getDelayedChannel (group + source)), (SampleType) row[source], numSamples);
+
+        mRouted[(size_t) line] = dest;
+    }
+}
+
+template <typename SampleType>
+int PingPongKernel<SampleType>::getGroupSize (const Routing& routing, int numLines) noexcept
+{
+    // A group size that doesn't divide the lines evenly falls back to one group
+    if (routing.groupSize <= 0 || routing.groupSize > numLines || numLines % routing.groupSize != 0)
+        return numLines;
+
+    return routing.groupSize;
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::filterFeedback (const FeedbackFilter::Coefficients& filter, int numSamples) noexcept
+{
+    /*
+        Only what goes back into the lines is filtered; the wet output still
+        hears the routed span as it is, so the first repeat keeps its tone
+        and each one after it is filtered once more.
+    */
+
+    std::array<SampleType*, maxChannels> filtered {};
+
+    for (int line = 0; line < mNumChannels; ++line)
+    {
+        filtered[(size_t) line] = getScratch (getFilteredChannel (line, mNumChannels));
+        mFeedback[(size_t) line] = filtered[(size_t) line];
+    }
+
+    FeedbackFilter::process (filter, mFilterState, mRouted.data(), filtered.data(), mNumChannels, numSamples);
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::diffuseFeedback (const BlockRamp& amount, const BlockRamp& mix, int numSamples) noexcept
+{
+    std::array<SampleType*, maxChannels> diffused {};
+
+    for (int line = 0; line < mNumChannels; ++line)
+        diffused[(size_t) line] = getScratch (getDiffusedChannel (line, mNumChannels));
+
+    mDiffuser.process (mRouted.data(), diffused.data(), amount, numSamples);
+
+    // While it fades in or out; diffused = routed + mix (diffused - routed)
+    if (mix.isRamping() || mix.start < 1.f)
+    {
+        auto* gains = getScratch (getSharedChannel (feedbackGains, mNumChannels));
+        BlockRamp::fill (gains, mix.start, (mix.end - mix.start) / (float) numSamples, numSamples);
+
+        for (int line = 0; line < mNumChannels; ++line)
+        {
+            DspCore::VectorOps::subtract (diffused[(size_t) line], mRouted[(size_t) line], numSamples);
+            DspCore::VectorOps::multiply (diffused[(size_t) line], gains, numSamples);
+            DspCore::VectorOps::add (diffused[(size_t) line], mRouted[(size_t) line], numSamples);
+        }
+    }
+
+    for (int line = 0; line < mNumChannels; ++line)
+        mRouted[(size_t) line] = diffused[(size_t) line];
+}
+
+template <typename SampleType>
+template <typename Interpolator>
+void PingPongKernel<SampleType>::accumulateTaps (const TapPattern& taps, const Parameters& params, int numSamples) noexcept
+{
+    /*
+        Every tap is a span of the circular buffer, so each one is a read
+        followed by two vector multiply-adds into the wet signal; one into
+        its own channel and one into the next channel along.
+    */
+
+    auto* span = getScratch (getSharedChannel (tapSpan, mNumChannels));
+    auto groupSize = getGroupSize (params.routing, mNumChannels);
+
+    for (int line = 0; line < mNumChannels; ++line)
+    {
+        auto* wet = getScratch (getTapWetChannel (line, mNumChannels));
+        DspCore::VectorOps::clear (wet, numSamples);
+        mWet[(size_t) line] = wet;
+    }
+
+    for (int line = 0; line < mNumChannels; ++line)
+    {
+        auto* wetSame = getScratch (getTapWetChannel (line, mNumChannels));
+        auto group = line - line % groupSize;
+        auto* wetNext = getScratch (getTapWetChannel (group + (line - group + 1) % groupSize, mNumChannels));
+
+        for (int i = 0; i < taps.numTaps; ++i)
+        {
+            auto& tap = taps.taps[(size_t) i];
+            auto delay = clampDelay<Interpolator> (scaleRamp (params.delays[(size_t) line], tap.delayScale), mMaximumDelay);
+
+            readSpan<Interpolator> (line, delay, span, numSamples, mReadHeadState[(size_t) getTapReadHead (line, i)]);
+            DspCore::VectorOps::addWithMultiply (wetSame, span, (SampleType) tap.gainToSame, numSamples);
+            DspCore::VectorOps::addWithMultiply (wetNext, span, (SampleType) tap.gainToNext, numSamples);
+        }
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+template <typename Interpolator>
+void PingPongKernel<SampleType>::readSpan (int channel, const BlockRamp& delay, SampleType* dest, int numSamples, SampleType& state) noexcept
+{
+    /*
+        Samples that would only read from before the line was last cleared
+        are silent, and aren't read at all, so their pages aren't touched.
+        The rest of the span is read as usual.
+    */
+
+    auto numUnwritten = mWritten[(size_t) channel] < mCapacity ? getNumUnwritten (channel, delay, numSamples) : 0;
+
+    if (numUnwritten == 0)
+    {
+        interpolateSpan<Interpolator> (channel, delay, dest, numSamples, 0, state);
+        return;
+    }
+
+    DspCore::VectorOps::clear (dest, numUnwritten);
+    state = SampleType();
+
+    if (numUnwritten < numSamples)
+        interpolateSpan<Interpolator> (channel, getSubRamp (delay, numUnwritten, numSamples - numUnwritten, numSamples),
+                                       dest + numUnwritten, numSamples - numUnwritten, numUnwritten, state);
+}
+
+template <typename SampleType>
+template <typename Interpolator>
+void PingPongKernel<SampleType>::interpolateSpan (int channel, const BlockRamp& delay, SampleType* dest, int numSamples, int offset, SampleType& state) noexcept
+{
+    // The span starts offset samples past the write position
+    auto writePosition = mWritePosition + offset;
+
+    constexpr auto isRounded = std::is_same<Interpolator, DelayInterpolation::None>::value;
+
+    if (! delay.isRamping())
+    {
+        // A steady delay on a whole sample is a straight copy, whatever the interpolator
+
+        if (isRounded || isWholeSample (delay.start))
+        {
+            copyFromLine (channel, writePosition - (int) std::lround (delay.start), dest, numSamples);
+            state = dest[numSamples - 1];
+            return;
+        }
+
+        /*
+            Otherwise every sample in the span sits the same fraction past a whole
+            sample, so the coefficients are worked out once and the interpolator
+            runs along a contiguous window copied out of the circular buffer.
+        */
+
+        auto whole = std::floor (delay.start);
+        auto fraction = 1.f - (delay.start - whole);
+        auto first = writePosition - (int) whole - 1;
+
+        auto* window = getScratch (getSharedChannel (SharedScratchChannel::window, mNumChannels));
+        copyFromLine (channel, first - Interpolator::before, window, numSamples + Interpolator::before + Interpolator::after);
+
+        auto coefficients = Interpolator::getCoefficients (fraction);
+        auto* x = window + Interpolator::before;
+
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = Interpolator::apply (x + i, coefficients, state);
+
+        return;
+    }
+
+    /*
+        A gliding delay reads a different fraction for every sample. The positions
+        are worked out a chunk at a time, a register of them at once. The first of
+        each register is found in double precision, as a float can't hold a
+        fraction of a sample this far into a long buffer, and the others are
+        small float steps on from it. The interpolator then reads the chunk.
+    */
+
+    using Positions = DspCore::SimdRegister<float>;
+    static_assert (DelayInterpolation::chunkLength % Positions::size == 0, "A chunk must be whole registers");
+
+    auto* line = mLines[(size_t) channel];
+    auto step = ((double) delay.end - (double) delay.start) / (double) numSamples;
+    auto speed = 1.0 - step;    // How far the read position moves each sample
+    auto origin = (double) writePosition - (double) delay.start + (isRounded ? 0.5 : 0.0);
+
+    float offsets[Positions::size], wholes[Positions::size];
+
+    for (int k = 0; k < Positions::size; ++k)
+        offsets[k] = (float) (speed * (double) k);
+
+    const auto steps = Positions::load (offsets);
+
+    int indices[DelayInterpolation::chunkLength];
+    float fractions[DelayInterpolation::chunkLength];
+
+    for (int start = 0; start < numSamples; start += DelayInterpolation::chunkLength)
+    {
+        auto length = std::min (DelayInterpolation::chunkLength, numSamples - start);
+
+        for (int i = 0; i < length; i += Positions::size)
+        {
+            // The position may be behind the start of the buffer; the mask wraps it either way
+            auto position = origin + speed * (double) (start + i);
+            auto whole = (int) position;
+            whole -= (double) whole > position ? 1 : 0;
+
+            auto positions = Positions::expand ((float) (position - (double) whole)) + steps;
+            auto floors = Positions::floor (positions);
+
+            (positions - floors).store (fractions + i);
+            floors.store (wholes);
+
+            for (int k = 0; k < Positions::size; ++k)
+                indices[i + k] = whole + (int) wholes[k];
+        }
+
+        Interpolator::process (line, mMask, indices, fractions, dest + start, length, state);
+    }
+}
+
+template <typename SampleType>
+int PingPongKernel<SampleType>::getNumUnwritten (int channel, const BlockRamp& delay, int numSamples) const noexcept
+{
+    /*
+        Sample i of the span is read from delay(i) - i samples behind the
+        write position, give or take the few the interpolator looks at
+        around it. It is silent if even the newest of those is further back
+        than the line has been written since it was cleared. The delay never
+        glides as fast as a sample per sample, so the distance only shrinks
+        along the span and the silent samples all come first.
+    */
+
+    auto written = (double) mWritten[(size_t) channel] + (double) (DelayInterpolation::maxAfter + 1);
+    auto step = ((double) delay.end - (double) delay.start) / (double) numSamples;
+
+    auto numSilent = step < 1.0 ? std::ceil (((double) delay.start - written) / (1.0 - step))
+                                : ((double) std::max (delay.start, delay.end) > written ? (double) numSamples : 0.0);
+
+    return (int) std::clamp (numSilent, 0.0, (double) numSamples);
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::copyFromLine (int channel, int startIndex, SampleType* dest, int numSamples) const noexcept
+{
+    assert (numSamples <= mCapacity);
+
+    auto* line = mLines[(size_t) channel];
+
+    startIndex &= mMask;
+
+    auto firstPart = std::min (numSamples, mCapacity - startIndex);
+
+    DspCore::VectorOps::copy (dest, line + startIndex, firstPart);
+
+    if (firstPart < numSamples)
+        DspCore::VectorOps::copy (dest + firstPart, line, numSamples - firstPart);
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::writeSpan (int channel, const SampleType* input, const SampleType* feedbackSource,
+                                            const SampleType* feedbackGains, SampleType feedback, int numSamples) noexcept
+{
+    auto* line = mLines[(size_t) channel];
+
+    auto writePiece = [&] (SampleType* dest, int offset, int length)
+    {
+        DspCore::VectorOps::copy (dest, input + offset, length);
+
+        if (feedbackGains != nullptr)
+            DspCore::VectorOps::addWithMultiply (dest, feedbackSource + offset, feedbackGains + offset, length);
+        else
+            DspCore::VectorOps::addWithMultiply (dest, feedbackSource + offset, feedback, length);
+    };
+
+    auto firstPart = std::min (numSamples, mCapacity - mWritePosition);
+
+    writePiece (line + mWritePosition, 0, firstPart);
+
+    if (firstPart < numSamples)
+        writePiece (line, firstPart, numSamples - firstPart);
+}
+
+//==============================================================================
+template <typename SampleType>
+void PingPongKernel<SampleType>::publishHeads (const Parameters& params) noexcept
+{
+    /*
+        Each head at the furthest back it got to in this call. The write
+        position goes last, with release, so a pager that sees it sees the
+        delays that go with it too.
+    */
+
+    auto& heads = *mHeads;
+    auto numTaps = params.mode == Mode::multiTap && params.taps != nullptr ? params.taps->numTaps : 0;
+
+    for (int line = 0; line < mNumPreparedLines; ++line)
+    {
+        auto isActive = line < mNumChannels;
+        auto& delay = params.delays[(size_t) line];
+        auto furthest = std::max (delay.start, delay.end);
+
+        heads.delays[(size_t) getReadHead (line)].store (isActive ? (int) std::ceil (furthest) : -1, std::memory_order_relaxed);
+
+        for (int tap = 0; tap < maxTaps; ++tap)
+        {
+            auto tapDelay = isActive && tap < numTaps ? (int) std::ceil (std::min (furthest * params.taps->taps[(size_t) tap].delayScale, (float) mMaximumDelay)) : -1;
+            heads.delays[(size_t) getTapReadHead (line, tap)].store (tapDelay, std::memory_order_relaxed);
+        }
+    }
+
+    heads.numLines.store (mNumChannels, std::memory_order_relaxed);
+    heads.writePosition.store (mWritePosition, std::memory_order_release);
+}
+
+template <typename SampleType>
+template <typename Function>
+void PingPongKernel<SampleType>::forEachPageRange (int line, int startIndex, int numSamples, Function&& function) const noexcept
+{
+    // The byte ranges of the block that hold samples [startIndex, startIndex + numSamples) of a line, wrapped
+
+    auto* base = static_cast<const SampleType*> (mMemory.getData());
+    auto lineOffset = (size_t) (mLines[(size_t) line] - base);
+
+    startIndex &= mMask;
+    numSamples = std::min (numSamples, mCapacity);
+
+    auto firstPart = std::min (numSamples, mCapacity - startIndex);
+
+    function ((lineOffset + (size_t) startIndex) * sizeof (SampleType), (size_t) firstPart * sizeof (SampleType));
+
+    if (firstPart < numSamples)
+        function (lineOffset * sizeof (SampleType), (size_t) (numSamples - firstPart) * sizeof (SampleType));
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::prefetch (int lookahead) const noexcept
+{
+    /*
+        The next lookahead samples the write head will overwrite, and those
+        every read head will read; they move along at the same speed. Each
+        read is paged from the interpolator's window margin behind it.
+    */
+
+    if (mHeads == nullptr)
+        return;
+
+    auto& heads = *mHeads;
+    auto writePosition = heads.writePosition.load (std::memory_order_acquire);
+    auto numLines = heads.numLines.load (std::memory_order_relaxed);
+
+    auto page = [this] (size_t offset, size_t numBytes) { mMemory.prefetch (offset, numBytes); };
+
+    for (int line = 0; line < numLines; ++line)
+    {
+        forEachPageRange (line, writePosition, lookahead, page);
+
+        auto pageHead = [&] (int head)
+        {
+            auto delay = heads.delays[(size_t) head].load (std::memory_order_relaxed);
+
+            if (delay >= 0)
+                forEachPageRange (line, writePosition - delay - windowMargin, lookahead + windowMargin, page);
+        };
+
+        pageHead (getReadHead (line));
+
+        for (int tap = 0; tap < maxTaps; ++tap)
+            pageHead (getTapReadHead (line, tap));
+    }
+}
+
+template <typename SampleType>
+void PingPongKernel<SampleType>::writeBehind() noexcept
+{
+    if (mHeads == nullptr)
+        return;
+
+    auto& heads = *mHeads;
+    auto writePosition = heads.writePosition.load (std::memory_order_acquire);
+    auto numLines = heads.numLines.load (std::memory_order_relaxed);
+
+    auto numWritten = (writePosition - mWrittenBackPosition) & mMask;
+
+    if (numWritten == 0)
+        return;
+
+    for (int line = 0; line < numLines; ++line)
+        forEachPageRange (line, mWrittenBackPosition, numWritten, [this] (size_t offset, size_t numBytes) { mMemory.writeBack (offset, numBytes); });
+
+    mWrittenBackPosition = writePosition;
+}
+
+//==============================================================================
+template class PingPongKernel<float>;
+template class PingPongKernel<double>;
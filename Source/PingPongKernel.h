@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    PingPongKernel.h
+
+    Block based ping-pong delay kernel used by TableTennisAudioProcessor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DspCore.h"
+#include "ParameterRamp.h"
+#include "DelayInterpolation.h"
+#include "FeedbackFilter.h"
+#include "FeedbackDiffuser.h"
+#include "DelayMemoryPool.h"
+
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+/**
+    The modes, limits and parameters shared by every PingPongKernel, whatever
+    its sample type.
+*/
+struct PingPongKernelBase
+{
+    //==============================================================================
+    enum class Mode
+    {
+        pingPong,       // The feedback is routed into the other lines
+        straight,       // Each line feeds back into itself
+        multiTap        // Ping-pong, with the wet signal made up of several taps
+    };
+
+    static constexpr int maxChannels = 16;  // Enough for third order ambisonics
+    static constexpr int maxTaps = 16;
+
+    /**
+        How the lines feed back into each other in ping-pong and multi-tap mode.
+
+        A rotation sends line (c + rotation) into line c, so with two channels a
+        rotation of one is the familiar left/right bounce. A matrix is numChannels
+        by numChannels, row major, one row per destination line.
+
+        The lines can also be split into groups of groupSize lines, one after
+        another, that are routed each on their own and never feed into each
+        other; the matrix is then groupSize by groupSize, and used for every
+        group. PingPongEngine's multiband mode has a group per band.
+    */
+    struct Routing
+    {
+        int rotation = 1;
+        const float* matrix = nullptr;      // Used instead of the rotation when set
+        int groupSize = 0;                  // 0 is all of the lines in one group
+    };
+
+    /**
+        One echo tap. Its delay is a fraction of its line's delay, so the taps
+        follow the delay time (and any glide) of the line they read from. Each
+        tap is panned between its own channel and the next one along.
+    */
+    struct Tap
+    {
+        float delayScale = 1.f;
+        float gainToSame = 0.f;     // How much of the tap goes to its own channel
+        float gainToNext = 0.f;     // How much goes to the next channel along
+    };
+
+    struct TapPattern
+    {
+        int numTaps = 0;            // Taps per line
+        std::array<Tap, maxTaps> taps;
+    };
+
+    /** Sum of squares of the signal read back out of the lines, for telemetry. */
+    struct EnergyMeter
+    {
+        double sumOfSquares = 0.0;
+        std::int64_t numSamples = 0;
+    };
+
+    struct Parameters
+    {
+        Mode mode = Mode::pingPong;
+        Routing routing;
+        const TapPattern* taps = nullptr;   // Only used in multiTap mode
+
+        const FeedbackFilter::Coefficients* feedbackFilter = nullptr;   // Tone of the repeats, if set
+
+        DelayInterpolation::Type interpolation = DelayInterpolation::Type::linear;
+
+        std::array<BlockRamp, maxChannels> delays;  // Delay of each line, in samples
+        std::array<BlockRamp, maxChannels> feedback;    // How much of each line's routed span goes back in
+        BlockRamp diffusion;                            // 0 to 1; how much each repeat is smeared
+        BlockRamp diffusionMix;                         // 0 to 1; how far the diffuser is faded in, 0 is off
+        BlockRamp mix;
+        BlockRamp gain;
+
+        float* wetPeaks = nullptr;  // If set, each line's wet peak is max'd into it, for metering
+        EnergyMeter* loopEnergy = nullptr;  // If set, the delayed spans are added into it
+    };
+};
+
+//==============================================================================
+/**
+    Owns the circular buffer (one delay line per channel) and runs the
+    cross-feedback delay on whole spans of samples at a time.
+
+    Instead of popping and pushing one sample per channel (with an index wrap
+    and an interpolation on every call) the kernel copies the delayed spans out
+    of the circular buffer, then does the feedback, dry/wet and gain maths with
+    DspCore::VectorOps, which are written with SSE2 on x86 and NEON on ARM.
+    Spans are only ever split where they meet the end of the circular buffer.
+
+    When the delay is shorter than the block the samples we would need have not
+    been written yet, so the block is walked in delay-length spans instead.
+    A very short delay therefore falls back to (close to) per-sample processing
+    automatically.
+
+    Every parameter arrives as a BlockRamp. Feedback, mix and gain ramps become
+    vectors of per-sample gains. The delay is read with the interpolation picked
+    in the parameters; the kernel is compiled once per interpolator, so a delay
+    that sits on a whole sample is always a plain copy and the expensive modes
+    only cost anything when they are picked.
+
+    The lines are stored one channel after another (structure of arrays), so
+    any number of channels from mono up to maxChannels works the same way. The
+    feedback is routed between the lines either by rotating them, which is the
+    classic ping-pong when there are two, or through a mixing matrix. Either
+    way the routing is done on whole spans, with the same vector operations.
+
+    Besides the ping-pong the kernel can run as a plain delay, or as a
+    multi-tap echo where up to maxTaps taps per line are read from the same
+    circular buffer and accumulated into the wet signal in one pass.
+
+    Once prepareDiffusion() has been called, the routed spans can also go
+    through a FeedbackDiffuser, which blurs every trip round the loop. Both
+    the wet signal and the feedback hear it, so it delays every repeat by
+    getDiffusionLatency(); the engine shortens the lines to make up for it.
+    The diffusionMix parameter crossfades it in and out, as the engine
+    glides the lines to their new length.
+
+    The kernel is a template on the sample type, and float and double are
+    both compiled from the same code in PingPongKernel.cpp. The double one
+    keeps a double precision circular buffer, so long feedback tails don't
+    build up float rounding. Parameters stay in float either way.
+
+    The circular buffer comes from the process-wide DelayMemoryPool, sized
+    for what prepare() asked for, and goes back to it on release(). Its
+    length is a power of two, so every line wraps with a mask off the one
+    shared write position instead of a compare or a modulo.
+
+    For very long delays prepare() can put the circular buffer in a mapped
+    scratch file instead. The audio thread then publishes where its heads
+    are after every call, and prefetch() and writeBehind(), run by a
+    DelayPager, keep the pages just ahead of them in memory and write back
+    the ones behind. A scratch file line isn't cleared on reset (that would
+    page the whole file through the audio thread); the kernel remembers how
+    much of it has been written since, and reads anything older as silence.
+
+    Like the rest of PingPongEngine, the kernel doesn't use JUCE.
+*/
+template <typename SampleType>
+class PingPongKernel  : public PingPongKernelBase
+{
+public:
+    //==============================================================================
+    /**
+        Takes the circular buffer from the pool and allocates the scratch space.
+        With a scratchDirectory, the circular buffer is a mapped file in it
+        instead, or comes from the pool after all if the file can't be made.
+        Not real-time safe.
+    */
+    void prepare (int numChannels, int maximumDelayInSamples, int maximumBlockSize, const std::string& scratchDirectory = {});
+
+    /** Clears the circular buffer, leaving its size untouched. */
+    void reset() noexcept;
+
+    /** Hands the circular buffer back to the pool; prepare() has to be called again before process(). */
+    void release();
+
+    /**
+        Runs only the first numLines of the lines prepare() made, and leaves the
+        rest alone. Lines that come back into use are cleared first, so they
+        start from silence. Real-time safe.
+    */
+    void setNumActiveLines (int numLines) noexcept;
+
+    /** Runs the delay in place on the channels it was prepared for. */
+    void process (SampleType* const* channels, int numSamples, const Parameters& params) noexcept;
+
+    /** Takes the memory for the diffuser, for every line prepare() made. Call it after prepare(). */
+    void prepareDiffusion (double sampleRate);
+
+    /** How many samples the diffuser delays the repeats by, or 0 if it isn't prepared. */
+    int getDiffusionLatency() const noexcept        { return mDiffuser.getLatency(); }
+
+    int getNumChannels() const noexcept             { return mNumChannels; }    // The active lines
+    int getMaximumDelayInSamples() const noexcept   { return mMaximumDelay; }
+
+    //==============================================================================
+    /** True if prepare() put the circular buffer in a mapped scratch file. */
+    bool isUsingScratchFile() const noexcept        { return mMemory.isMapped(); }
+
+    /*
+        The paging tasks, for a DelayPager's threads, while the kernel is
+        prepared with a scratch file; they do nothing otherwise. prefetch()
+        pages in the next lookahead samples past every head, and
+        writeBehind() writes back whatever has been written since its last
+        call. Each must only be run by one thread at a time.
+    */
+
+    void prefetch (int lookahead) const noexcept;
+    void writeBehind() noexcept;
+
+private:
+    //==============================================================================
+    /*
+        Each read head (every line's main read and every tap) keeps a state
+        value for interpolators that have memory, i.e. Thiran.
+    */
+
+    static constexpr int numReadHeads = maxChannels * (1 + maxTaps);
+
+    static int getReadHead (int channel) noexcept               { return channel; }
+    static int getTapReadHead (int channel, int tap) noexcept   { return maxChannels + channel * maxTaps + tap; }
+
+    template <typename Interpolator>
+    void processWith (SampleType* const* channels, int numSamples, const Parameters& params) noexcept;
+
+    template <typename Interpolator>
+    void processSpan (SampleType* const* channels, int numSamples, const Parameters& params) noexcept;
+
+    template <typename Interpolator>
+    int getMaximumSpan (const BlockRamp& delay) const noexcept;
+
+    template <typename Interpolator>
+    void readSpan (int channel, const BlockRamp& delay, SampleType* dest, int numSamples, SampleType& state) noexcept;
+
+    template <typename Interpolator>
+    void interpolateSpan (int channel, const BlockRamp& delay, SampleType* dest, int numSamples, int offset, SampleType& state) noexcept;
+
+    int getNumUnwritten (int channel, const BlockRamp& delay, int numSamples) const noexcept;
+    void publishHeads (const Parameters& params) noexcept;
+
+    template <typename Function>
+    void forEachPageRange (int line, int startIndex, int numSamples, Function&& function) const noexcept;
+
+    template <typename Interpolator>
+    void accumulateTaps (const TapPattern& taps, const Parameters& params, int numSamples) noexcept;
+
+    void routeFeedback (const Parameters& params, int numSamples) noexcept;
+    void clearLine (int line) noexcept;
+    void clearSamples (int line) noexcept;
+
+    static int getGroupSize (const Routing& routing, int numLines) noexcept;
+    void filterFeedback (const FeedbackFilter::Coefficients& filter, int numSamples) noexcept;
+    void diffuseFeedback (const BlockRamp& amount, const BlockRamp& mix, int numSamples) noexcept;
+
+    void copyFromLine (int channel, int startIndex, SampleType* dest, int numSamples) const noexcept;
+    void writeSpan (int channel, const SampleType* input, const SampleType* feedbackSource,
+                    const SampleType* feedbackGains, SampleType feedback, int numSamples) noexcept;
+
+    SampleType* getScratch (int channel) noexcept   { return mScratch.data() + (size_t) channel * (size_t) mScratchLength; }
+
+    //==============================================================================
+    DelayMemoryPool::Block mMemory;            // The circular buffer, one line after another
+    std::array<SampleType*, maxChannels> mLines {};
+
+    std::vector<SampleType> mScratch;          // Delayed spans, taps and per-sample gains for one span
+    int mScratchLength = 0;                    // Samples in each scratch channel
+
+    // Where each line's routed feedback, filtered feedback and wet signal are for the current span
+    std::array<const SampleType*, maxChannels> mRouted {};
+    std::array<const SampleType*, maxChannels> mFeedback {};
+    std::array<const SampleType*, maxChannels> mWet {};
+
+    int mNumChannels = 0;                   // Active lines
+    int mNumPreparedLines = 0;
+    int mCapacity = 0;                      // A power of two
+    int mMask = 0;                          // mCapacity - 1
+    int mMaximumDelay = 0;
+    int mMaximumBlockSize = 0;
+    int mWritePosition = 0;
+
+    /*
+        How many samples have been written to each line since it was last
+        cleared, up to mCapacity; anything further back reads as silence.
+    */
+
+    std::array<int, maxChannels> mWritten {};
+
+    /*
+        Where the heads are, for the pager's threads. Every read head's delay
+        is in samples behind the write position, or -1 when it isn't in use.
+        Only made for a scratch file.
+    */
+
+    struct PublishedHeads
+    {
+        std::atomic<int> writePosition { 0 };
+        std::atomic<int> numLines { 0 };
+        std::array<std::atomic<int>, numReadHeads> delays;
+    };
+
+    std::unique_ptr<PublishedHeads> mHeads;
+    int mWrittenBackPosition = 0;           // The write-behind thread's own
+
+    std::array<SampleType, numReadHeads> mReadHeadState {};
+    FeedbackFilter::State<SampleType> mFilterState;
+    FeedbackDiffuser<SampleType> mDiffuser;
+    bool mDiffusing = false;
+};
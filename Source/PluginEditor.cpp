@@ -1,164 +1,493 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-TableTennisAudioProcessorEditor::TableTennisAudioProcessorEditor (TableTennisAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
-    : AudioProcessorEditor (&p), audioProcessor (p), treeState(vts)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize(450, 750); // 500 = the width of the plugin & 450 = the height of the plugin
-
-
-    // Bypass Toggle
-
-    bypassValue = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(treeState, "audioBypass", bypassButton);
-    bypassButton.setToggleable(true);
-    addAndMakeVisible(bypassButton);
-
-
-    // Effects Selection
-
-     //effectsCombo.addItem("Ping Pong Delay", 1); // Look at ladder filter for comparison of Case-sensitive spelling.
-     //effectsCombo.addItem("Delay", 2);
-     //effectsCombo.addItem("Echo", 3);
-     //effectsChoice = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(treeState, "effectsMode", effectsCombo);
-     //addAndMakeVisible(&effectsCombo);
-
-
-    // Delay time
-
-    delayTimeValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "delayTime", delayTimeSlider);
-    delayTimeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    delayTimeSlider.setRange(0.0f, 5000.0f, 1.0f);
-    delayTimeSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
-    addAndMakeVisible(&delayTimeSlider);
-
-    addAndMakeVisible(delayTimeLabel);
-    delayTimeLabel.setText("Delay time (samples)", juce::dontSendNotification);
-    delayTimeLabel.attachToComponent(&delayTimeSlider, false);
-
-
-    // Feedback
-
-    feedbackValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "feedback", feedbackSlider);
-    feedbackSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    feedbackSlider.setRange(0.0f, 0.99f, 0.01f);
-    feedbackSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
-    addAndMakeVisible(&feedbackSlider);
-
-    addAndMakeVisible(feedbackLabel);
-    feedbackLabel.setText("Feedback", juce::dontSendNotification);
-    feedbackLabel.attachToComponent(&feedbackSlider, false);
-
-
-    // Gain 
-
-    gainValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "gain", gainSlider);
-    gainSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    gainSlider.setRange(0.0f, 0.99f, 0.01f);
-    gainSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
-    addAndMakeVisible(&gainSlider);
-
-    addAndMakeVisible(gainLabel);
-    gainLabel.setText("Gain", juce::dontSendNotification);
-    gainLabel.attachToComponent(&gainSlider, false);
-
-
-    // Panning - Wet Dry control
-
-    mixingValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "mix", mixingSlider);
-    mixingSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
-    mixingSlider.setRange(0.0f, 1.0f, 0.01f);
-    mixingSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 75, 25);
-    addAndMakeVisible(&mixingSlider);
-
-    addAndMakeVisible(mixingLabel);
-    mixingLabel.setText("Dry-Wet Control", juce::dontSendNotification);
-    mixingLabel.attachToComponent(&mixingSlider, true);
-
-
-    // Offset L
-    offsetLValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "offsetL", offsetLSlider);
-    offsetLSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    offsetLSlider.setRange(0.0f, 1000.0f, 1.0f);
-    offsetLSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
-    addAndMakeVisible(&offsetLSlider);
-
-    addAndMakeVisible(offsetLLabel);
-    offsetLLabel.setText("Offset L (milliseconds)", juce::dontSendNotification);
-    offsetLLabel.attachToComponent(&offsetLSlider, false);
-
-    // Offset R
-    offsetLValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "offsetR", offsetRSlider);
-    offsetRSlider.setSliderStyle(juce::Slider::LinearHorizontal);
-    offsetRSlider.setRange(0.0f, 1000.0f, 1.0f);
-    offsetRSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
-    addAndMakeVisible(&offsetRSlider);
-
-    addAndMakeVisible(offsetRLabel);
-    offsetRLabel.setText("Offset R (milliseconds)", juce::dontSendNotification);
-    offsetRLabel.attachToComponent(&offsetRSlider, false);
-}
-
-TableTennisAudioProcessorEditor::~TableTennisAudioProcessorEditor()
-{
-}
-
-//==============================================================================
-void TableTennisAudioProcessorEditor::paint(juce::Graphics& g)
-{
-
-    // Title - due to the image implementation format getting rid of the original one
-    
-    titleLabel.setText("Table Tennis", juce::dontSendNotification);
-    titleLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible(&titleLabel);
-
-    titleLabel.setBounds(35, 10, 210, 50);
-
-    //g.setFont(30);
-    //g.drawFittedText("Table Tennis", 35, 20, 210, 50, juce::Justification::centred, 1, 0.0f);
-
-    juce::Image ttImage = juce::ImageCache::getFromMemory(BinaryData::Table_Tennis_1_png, BinaryData::Table_Tennis_1_pngSize);
-    if (!ttImage.isNull())
-        g.drawImageWithin(ttImage, 0, 0, 450, 750, 0);
-    else
-        jassert(!ttImage.isNull()); // This checks if the image is loading correctly and if it is in the right place! 
-
-    //g.setColour(juce::Colours::white);
-}
-
-void TableTennisAudioProcessorEditor::resized()
-{
-
-    /* 
-        This is where the bounds are set for the plugin.
-        It uses the following format:
-
-        (int1, int2, int3, int4)
-
-        int1 = Is the starting point for height (offset X-axis)
-        int2 = Is the end point for width (offset Y-axis)
-        int3 = Is the attachments x scale
-        int4 = Is the attachments y scale
-
-        Allowing for placement around the plugin's UI
-    */
-    //effectsCombo.setBounds(40, 50, 150, 30);
-    delayTimeSlider.setBounds(50, 110, 320, 50);
-    feedbackSlider.setBounds(50, 180, 320, 50);
-    gainSlider.setBounds(50, 250, 320, 50);
-    offsetLSlider.setBounds(50, 320, 320, 50);
-    offsetRSlider.setBounds(50, 390, 320, 50);
-    bypassButton.setBounds(400, 50, 50, 25);
-    mixingSlider.setBounds(100, 460, 200, 200);
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+TableTennisAudioProcessorEditor::TableTennisAudioProcessorEditor (TableTennisAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
+    : AudioProcessorEditor (&p), audioProcessor (p), treeState(vts), visualiser(p.getVisualiserFifo())
+{
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setOpaque(true);
+    setSize(450, 1210); // 450 = the width of the plugin & 1210 = the height of the plugin
+
+
+    // Title - due to the image implementation format getting rid of the original one
+
+    titleLabel.setText("Table Tennis", juce::dontSendNotification);
+    titleLabel.setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(&titleLabel);
+
+
+    // Visualiser - the processor only measures anything while it is showing
+
+    addAndMakeVisible(visualiser);
+    audioProcessor.setVisualiserActive(true);
+
+
+    // Telemetry - what this instance costs, read from the processor a few times a second
+
+   #if TABLETENNIS_TELEMETRY
+    telemetryLabel.setFont(juce::Font(12.0f));
+    telemetryLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(telemetryLabel);
+   #endif
+
+
+    // Programs - picking one switches the processor straight away; Save adds the current settings as a user program
+
+    programCombo.onChange = [this]
+    {
+        auto index = programCombo.getSelectedItemIndex();
+
+        if (index >= 0 && index != audioProcessor.getCurrentProgram())
+            audioProcessor.setCurrentProgram(index);
+    };
+    addAndMakeVisible(programCombo);
+
+    saveProgramButton.onClick = [this]
+    {
+        audioProcessor.saveProgram("User " + juce::String(audioProcessor.getNumPrograms() + 1));
+        updateProgramList();
+    };
+    addAndMakeVisible(saveProgramButton);
+
+    updateProgramList();
+    startTimerHz(4);
+
+
+    // Morph - blends the settings towards another program, by its number in the list
+
+    morphValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "morph", morphSlider);
+    morphSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    morphSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 50, 20);
+    addAndMakeVisible(&morphSlider);
+
+    addAndMakeVisible(morphLabel);
+    morphLabel.setText("Morph", juce::dontSendNotification);
+    morphLabel.attachToComponent(&morphSlider, true);
+
+    morphTargetValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "morphTarget", morphTargetSlider);
+    morphTargetSlider.setSliderStyle(juce::Slider::IncDecButtons);
+    morphTargetSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxLeft, true, 35, 20);
+    addAndMakeVisible(&morphTargetSlider);
+
+
+    // Long Delay - loops of up to five minutes, kept on disk; the loop time takes over from the delay time
+
+    longDelayValue = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(treeState, "longDelay", longDelayButton);
+    addAndMakeVisible(longDelayButton);
+
+    loopTimeValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "loopTime", loopTimeSlider);
+    loopTimeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    loopTimeSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 50, 20);
+    addAndMakeVisible(&loopTimeSlider);
+
+    addAndMakeVisible(loopTimeLabel);
+    loopTimeLabel.setText("Loop (s)", juce::dontSendNotification);
+    loopTimeLabel.attachToComponent(&loopTimeSlider, true);
+
+
+    // Bypass Toggle
+
+    bypassValue = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(treeState, "audioBypass", bypassButton);
+    bypassButton.setToggleable(true);
+    addAndMakeVisible(bypassButton);
+
+
+    // Effects Selection - the items come from the parameter, so they always match its order
+
+    effectsCombo.addItemList(treeState.getParameter("effectsMode")->getAllValueStrings(), 1);
+    effectsChoice = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(treeState, "effectsMode", effectsCombo);
+    addAndMakeVisible(&effectsCombo);
+
+
+    // Delay read quality - cheap for big live sessions, HQ Sinc for offline renders
+
+    interpolationCombo.addItemList(treeState.getParameter("interpolation")->getAllValueStrings(), 1);
+    interpolationChoice = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(treeState, "interpolation", interpolationCombo);
+    addAndMakeVisible(&interpolationCombo);
+
+
+    // Multi-Tap Echo controls - number of taps, how fast they fade and how wide they bounce
+
+    for (auto* knob : { &tapCountSlider, &tapDecaySlider, &tapSpreadSlider })
+    {
+        knob->setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+        knob->setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 50, 20);
+        addAndMakeVisible(knob);
+    }
+
+    tapCountValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "tapCount", tapCountSlider);
+    tapDecayValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "tapDecay", tapDecaySlider);
+    tapSpreadValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "tapSpread", tapSpreadSlider);
+
+    tapCountLabel.setText("Taps", juce::dontSendNotification);
+    tapDecayLabel.setText("Decay", juce::dontSendNotification);
+    tapSpreadLabel.setText("Spread", juce::dontSendNotification);
+
+    tapCountLabel.attachToComponent(&tapCountSlider, true);
+    tapDecayLabel.attachToComponent(&tapDecaySlider, true);
+    tapSpreadLabel.attachToComponent(&tapSpreadSlider, true);
+
+
+    // Delay time
+
+    delayTimeValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "delayTime", delayTimeSlider);
+    delayTimeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    delayTimeSlider.setRange(1.0f, TableTennisAudioProcessor::maxDelayTimeMs, 1.0f);
+    delayTimeSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
+    addAndMakeVisible(&delayTimeSlider);
+
+    addAndMakeVisible(delayTimeLabel);
+    delayTimeLabel.setText("Delay time (milliseconds)", juce::dontSendNotification);
+    delayTimeLabel.attachToComponent(&delayTimeSlider, false);
+
+
+    // Tempo Sync - overrides the delay time with a note length when not "Free"
+
+    tempoSyncCombo.addItemList(treeState.getParameter("tempoSync")->getAllValueStrings(), 1);
+    tempoSyncChoice = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(treeState, "tempoSync", tempoSyncCombo);
+    addAndMakeVisible(&tempoSyncCombo);
+
+
+    // Feedback
+
+    feedbackValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "feedback", feedbackSlider);
+    feedbackSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    feedbackSlider.setRange(0.0f, 0.99f, 0.01f);
+    feedbackSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
+    addAndMakeVisible(&feedbackSlider);
+
+    addAndMakeVisible(feedbackLabel);
+    feedbackLabel.setText("Feedback", juce::dontSendNotification);
+    feedbackLabel.attachToComponent(&feedbackSlider, false);
+
+
+    // Feedback Routing - how the repeats move round the channels; with two, a rotation of 1 is the ping-pong
+
+    feedbackRoutingCombo.addItemList(treeState.getParameter("feedbackRouting")->getAllValueStrings(), 1);
+    feedbackRoutingChoice = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(treeState, "feedbackRouting", feedbackRoutingCombo);
+    addAndMakeVisible(&feedbackRoutingCombo);
+
+    feedbackRotationValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "feedbackRotation", feedbackRotationSlider);
+    feedbackRotationSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+    feedbackRotationSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 50, 20);
+    addAndMakeVisible(&feedbackRotationSlider);
+
+    addAndMakeVisible(feedbackRotationLabel);
+    feedbackRotationLabel.setText("Rotate", juce::dontSendNotification);
+    feedbackRotationLabel.attachToComponent(&feedbackRotationSlider, false);
+
+
+    // Feedback tone - filters the repeats inside the loop, so each one is darker or thinner than the last, and diffuses them into a wash
+
+    for (auto* knob : { &lowCutSlider, &highCutSlider, &tiltSlider, &diffusionSlider })
+    {
+        knob->setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+        knob->setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 50, 20);
+        addAndMakeVisible(knob);
+    }
+
+    lowCutValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "lowCut", lowCutSlider);
+    highCutValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "highCut", highCutSlider);
+    tiltValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "tilt", tiltSlider);
+    diffusionValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "diffusion", diffusionSlider);
+
+    lowCutLabel.setText("Lo Cut", juce::dontSendNotification);
+    highCutLabel.setText("Hi Cut", juce::dontSendNotification);
+    tiltLabel.setText("Tilt", juce::dontSendNotification);
+    diffusionLabel.setText("Diff", juce::dontSendNotification);
+
+    lowCutLabel.attachToComponent(&lowCutSlider, true);
+    highCutLabel.attachToComponent(&highCutSlider, true);
+    tiltLabel.attachToComponent(&tiltSlider, true);
+    diffusionLabel.attachToComponent(&diffusionSlider, true);
+
+
+    // Modulation - an LFO on the delay time, for chorus, flutter and tape wow
+
+    for (auto* knob : { &modRateSlider, &modDepthSlider, &modPhaseSlider, &modDriftSlider })
+    {
+        knob->setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+        knob->setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 50, 20);
+        addAndMakeVisible(knob);
+    }
+
+    modRateValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "modRate", modRateSlider);
+    modDepthValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "modDepth", modDepthSlider);
+    modPhaseValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "modPhase", modPhaseSlider);
+    modDriftValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "modDrift", modDriftSlider);
+
+    modRateLabel.setText("Rate", juce::dontSendNotification);
+    modDepthLabel.setText("Depth", juce::dontSendNotification);
+    modPhaseLabel.setText("Phase", juce::dontSendNotification);
+    modDriftLabel.setText("Drift", juce::dontSendNotification);
+
+    modRateLabel.attachToComponent(&modRateSlider, true);
+    modDepthLabel.attachToComponent(&modDepthSlider, true);
+    modPhaseLabel.attachToComponent(&modPhaseSlider, true);
+    modDriftLabel.attachToComponent(&modDriftSlider, true);
+
+
+    // Multiband - how many bands, where they split, and the delay of bands 2 to 4 (band 1 uses the controls above)
+
+    bandsValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "bands", bandsSlider);
+    bandsSlider.setSliderStyle(juce::Slider::IncDecButtons);
+    bandsSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxLeft, true, 35, 20);
+    addAndMakeVisible(&bandsSlider);
+
+    addAndMakeVisible(bandsLabel);
+    bandsLabel.setText("Bands", juce::dontSendNotification);
+    bandsLabel.attachToComponent(&bandsSlider, true);
+
+    bandSelectCombo.addItemList({ "Band 2", "Band 3", "Band 4" }, 2);
+    bandSelectCombo.onChange = [this] { attachBandControls(bandSelectCombo.getSelectedId()); };
+    addAndMakeVisible(&bandSelectCombo);
+
+    addAndMakeVisible(bandSelectLabel);
+    bandSelectLabel.setText("Edit", juce::dontSendNotification);
+    bandSelectLabel.attachToComponent(&bandSelectCombo, true);
+
+    for (auto* knob : { &crossover1Slider, &crossover2Slider, &crossover3Slider,
+                        &bandDelayTimeSlider, &bandFeedbackSlider, &bandOffsetLSlider, &bandOffsetRSlider })
+    {
+        knob->setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+        knob->setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 50, 20);
+        addAndMakeVisible(knob);
+    }
+
+    crossover1Value = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "crossover1", crossover1Slider);
+    crossover2Value = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "crossover2", crossover2Slider);
+    crossover3Value = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "crossover3", crossover3Slider);
+
+    crossover1Label.setText("X 1-2", juce::dontSendNotification);
+    crossover2Label.setText("X 2-3", juce::dontSendNotification);
+    crossover3Label.setText("X 3-4", juce::dontSendNotification);
+    bandDelayTimeLabel.setText("Delay", juce::dontSendNotification);
+    bandFeedbackLabel.setText("Fdbk", juce::dontSendNotification);
+    bandOffsetLLabel.setText("Off L", juce::dontSendNotification);
+    bandOffsetRLabel.setText("Off R", juce::dontSendNotification);
+
+    crossover1Label.attachToComponent(&crossover1Slider, true);
+    crossover2Label.attachToComponent(&crossover2Slider, true);
+    crossover3Label.attachToComponent(&crossover3Slider, true);
+    bandDelayTimeLabel.attachToComponent(&bandDelayTimeSlider, true);
+    bandFeedbackLabel.attachToComponent(&bandFeedbackSlider, true);
+    bandOffsetLLabel.attachToComponent(&bandOffsetLSlider, true);
+    bandOffsetRLabel.attachToComponent(&bandOffsetRSlider, true);
+
+    bandSelectCombo.setSelectedId(2, juce::dontSendNotification);
+    attachBandControls(2);
+
+
+    // Gain 
+
+    gainValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "gain", gainSlider);
+    gainSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    gainSlider.setRange(0.0f, 0.99f, 0.01f);
+    gainSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
+    addAndMakeVisible(&gainSlider);
+
+    addAndMakeVisible(gainLabel);
+    gainLabel.setText("Gain", juce::dontSendNotification);
+    gainLabel.attachToComponent(&gainSlider, false);
+
+
+    // Panning - Wet Dry control
+
+    mixingValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "mix", mixingSlider);
+    mixingSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+    mixingSlider.setRange(0.0f, 1.0f, 0.01f);
+    mixingSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, true, 75, 25);
+    addAndMakeVisible(&mixingSlider);
+
+    addAndMakeVisible(mixingLabel);
+    mixingLabel.setText("Dry-Wet Control", juce::dontSendNotification);
+    mixingLabel.attachToComponent(&mixingSlider, true);
+
+
+    // Offset L
+    offsetLValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "offsetL", offsetLSlider);
+    offsetLSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    offsetLSlider.setRange(0.0f, TableTennisAudioProcessor::maxOffsetMs, 1.0f);
+    offsetLSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
+    addAndMakeVisible(&offsetLSlider);
+
+    addAndMakeVisible(offsetLLabel);
+    offsetLLabel.setText("Offset L (milliseconds)", juce::dontSendNotification);
+    offsetLLabel.attachToComponent(&offsetLSlider, false);
+
+    // Offset R
+    offsetLValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "offsetR", offsetRSlider);
+    offsetRSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    offsetRSlider.setRange(0.0f, TableTennisAudioProcessor::maxOffsetMs, 1.0f);
+    offsetRSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxRight, true, 75, 25);
+    addAndMakeVisible(&offsetRSlider);
+
+    addAndMakeVisible(offsetRLabel);
+    offsetRLabel.setText("Offset R (milliseconds)", juce::dontSendNotification);
+    offsetRLabel.attachToComponent(&offsetRSlider, false);
+}
+
+TableTennisAudioProcessorEditor::~TableTennisAudioProcessorEditor()
+{
+    stopTimer();
+    audioProcessor.setVisualiserActive(false);
+}
+
+void TableTennisAudioProcessorEditor::attachBandControls(int band)
+{
+    // The old attachments have to go first, so they stop listening to the knobs before the new ones take over
+
+    bandDelayTimeValue.reset();
+    bandFeedbackValue.reset();
+    bandOffsetLValue.reset();
+    bandOffsetRValue.reset();
+
+    auto suffix = juce::String(band);
+
+    bandDelayTimeValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "delayTime" + suffix, bandDelayTimeSlider);
+    bandFeedbackValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "feedback" + suffix, bandFeedbackSlider);
+    bandOffsetLValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "offsetL" + suffix, bandOffsetLSlider);
+    bandOffsetRValue = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(treeState, "offsetR" + suffix, bandOffsetRSlider);
+}
+
+void TableTennisAudioProcessorEditor::updateProgramList()
+{
+    juce::StringArray names;
+
+    for (int i = 0; i < audioProcessor.getNumPrograms(); ++i)
+        names.add(audioProcessor.getProgramName(i));
+
+    if (names != shownProgramNames)
+    {
+        programCombo.clear(juce::dontSendNotification);
+        programCombo.addItemList(names, 1);
+        shownProgramNames = names;
+    }
+
+    programCombo.setSelectedItemIndex(audioProcessor.getCurrentProgram(), juce::dontSendNotification);
+}
+
+void TableTennisAudioProcessorEditor::timerCallback()
+{
+    updateProgramList();
+
+   #if TABLETENNIS_TELEMETRY
+    TelemetrySnapshot snapshot;
+
+    if (! audioProcessor.getTelemetry().read(snapshot) || snapshot.numBlocks == 0)
+        return;
+
+    auto text = "CPU " + juce::String(snapshot.cpuLoad * 100.0, 2) + "%"
+              + "   block " + juce::String(snapshot.meanMicros, 0) + " / " + juce::String(snapshot.p99Micros, 0)
+              + " / " + juce::String(snapshot.maxMicros, 0) + " us (mean / p99 / max)"
+              + "   late " + juce::String(snapshot.totalBlocksOverBudget)
+              + "   out " + juce::String(snapshot.peakDb, 1) + " dB";
+
+    telemetryLabel.setText(text, juce::dontSendNotification);
+   #endif
+}
+
+//==============================================================================
+void TableTennisAudioProcessorEditor::paint(juce::Graphics& g)
+{
+    // Everything is already drawn into the cached background, so a repaint is a single blit
+
+    g.drawImageAt(background, 0, 0);
+}
+
+void TableTennisAudioProcessorEditor::updateBackground()
+{
+    /*
+        Draws the background image, scaled, into an image the size of the
+        editor. The image only covers the top 750 pixels; the rows below it
+        get the plain background colour.
+    */
+
+    background = juce::Image(juce::Image::RGB, juce::jmax(1, getWidth()), juce::jmax(1, getHeight()), false);
+
+    juce::Graphics g(background);
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+
+    //g.setFont(30);
+    //g.drawFittedText("Table Tennis", 35, 20, 210, 50, juce::Justification::centred, 1, 0.0f);
+
+    juce::Image ttImage = juce::ImageCache::getFromMemory(BinaryData::Table_Tennis_1_png, BinaryData::Table_Tennis_1_pngSize);
+    if (!ttImage.isNull())
+        g.drawImageWithin(ttImage, 0, 0, 450, 750, 0);
+    else
+        jassert(!ttImage.isNull()); // This checks if the image is loading correctly and if it is in the right place! 
+
+    //g.setColour(juce::Colours::white);
+}
+
+void TableTennisAudioProcessorEditor::resized()
+{
+
+    /* 
+        This is where the bounds are set for the plugin.
+        It uses the following format:
+
+        (int1, int2, int3, int4)
+
+        int1 = Is the starting point for height (offset X-axis)
+        int2 = Is the end point for width (offset Y-axis)
+        int3 = Is the attachments x scale
+        int4 = Is the attachments y scale
+
+        Allowing for placement around the plugin's UI
+    */
+    effectsCombo.setBounds(40, 55, 150, 25);
+    interpolationCombo.setBounds(200, 55, 120, 25);
+    delayTimeSlider.setBounds(50, 110, 320, 50);
+    tempoSyncCombo.setBounds(375, 122, 65, 25);
+    feedbackSlider.setBounds(50, 180, 320, 50);
+    feedbackRoutingCombo.setBounds(375, 192, 65, 25);
+    feedbackRotationSlider.setBounds(375, 250, 65, 65);
+    gainSlider.setBounds(50, 250, 320, 50);
+    offsetLSlider.setBounds(50, 320, 320, 50);
+    offsetRSlider.setBounds(50, 390, 320, 50);
+    bypassButton.setBounds(400, 50, 50, 25);
+    mixingSlider.setBounds(100, 460, 200, 200);
+    tapCountSlider.setBounds(370, 450, 70, 70);
+    tapDecaySlider.setBounds(370, 530, 70, 70);
+    tapSpreadSlider.setBounds(370, 610, 70, 70);
+    lowCutSlider.setBounds(70, 675, 60, 65);
+    highCutSlider.setBounds(190, 675, 60, 65);
+    tiltSlider.setBounds(300, 675, 60, 65);
+    diffusionSlider.setBounds(390, 685, 50, 65);
+    modRateSlider.setBounds(55, 760, 55, 65);
+    modDepthSlider.setBounds(165, 760, 55, 65);
+    modPhaseSlider.setBounds(275, 760, 55, 65);
+    modDriftSlider.setBounds(385, 760, 55, 65);
+    bandsSlider.setBounds(55, 845, 100, 25);
+    bandSelectCombo.setBounds(275, 845, 90, 25);
+    crossover1Slider.setBounds(55, 885, 55, 65);
+    crossover2Slider.setBounds(165, 885, 55, 65);
+    crossover3Slider.setBounds(275, 885, 55, 65);
+    bandDelayTimeSlider.setBounds(55, 960, 55, 65);
+    bandFeedbackSlider.setBounds(165, 960, 55, 65);
+    bandOffsetLSlider.setBounds(275, 960, 55, 65);
+    bandOffsetRSlider.setBounds(385, 960, 55, 65);
+    titleLabel.setBounds(35, 10, 210, 50);
+    longDelayButton.setBounds(10, 1030, 100, 25);
+    loopTimeSlider.setBounds(185, 1030, 255, 25);
+    visualiser.setBounds(10, 1065, 430, 75);
+    telemetryLabel.setBounds(10, 1145, 430, 20);
+    programCombo.setBounds(250, 20, 130, 22);
+    saveProgramButton.setBounds(385, 20, 55, 22);
+    morphSlider.setBounds(60, 1175, 270, 25);
+    morphTargetSlider.setBounds(340, 1175, 100, 25);
+
+    if (background.getWidth() != getWidth() || background.getHeight() != getHeight())
+        updateBackground();
+}
@@ -1,71 +1,177 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-/**
-*/
-class TableTennisAudioProcessorEditor  : public juce::AudioProcessorEditor
-{
-public:
-    TableTennisAudioProcessorEditor (TableTennisAudioProcessor&, juce::AudioProcessorValueTreeState&);
-    ~TableTennisAudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-
-private:
- 
-    //This allows for the labling and updating of the interfaces' sliders and dials in Real Time
-
-    TableTennisAudioProcessor& audioProcessor;
-    juce::AudioProcessorValueTreeState& treeState;
-
-    // Juce Contrl variables
-    
-    juce::Slider delayTimeSlider;
-    juce::Slider feedbackSlider;
-    juce::Slider gainSlider;
-    juce::Slider mixingSlider;
-    juce::Slider offsetLSlider;
-    juce::Slider offsetRSlider;
-    juce::ToggleButton bypassButton;
-    juce::ComboBox effectsCombo;
-
-
-    // Text String variables
-    
-    juce::Label delayTimeLabel;
-    juce::Label feedbackLabel;
-    juce::Label gainLabel;
-    juce::Label mixingLabel;
-    juce::Label offsetLLabel;
-    juce::Label offsetRLabel;
-    juce::Label bypassLabel;
-    juce::Label titleLabel;
-
-
-    // Scalar values of the Attachments
-    
-    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> delayTimeValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> feedbackValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> gainValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> mixingValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> offsetLValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> offsetRValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::ButtonAttachment> bypassValue;
-    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> effectsChoice;
-    
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TableTennisAudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "DelayVisualiser.h"
+
+//==============================================================================
+/**
+*/
+class TableTennisAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                         private juce::Timer
+{
+public:
+    TableTennisAudioProcessorEditor (TableTennisAudioProcessor&, juce::AudioProcessorValueTreeState&);
+    ~TableTennisAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+ 
+    //This allows for the labling and updating of the interfaces' sliders and dials in Real Time
+
+    TableTennisAudioProcessor& audioProcessor;
+    juce::AudioProcessorValueTreeState& treeState;
+
+    /*
+    The background image, scaled to the editor's size once in resized()
+    rather than on every repaint.
+    */
+
+    juce::Image background;
+
+    void updateBackground();
+
+    // Live levels and echoes, fed by the processor
+    DelayVisualiser visualiser;
+
+    // The processor's telemetry, refreshed by the timer
+    juce::Label telemetryLabel;
+
+    // Programs; the list is refreshed by the timer, as the host can change them too
+    juce::ComboBox programCombo;
+    juce::TextButton saveProgramButton{ "Save" };
+    juce::StringArray shownProgramNames;
+
+    void updateProgramList();
+    void timerCallback() override;
+
+    // Points the band knobs at the parameters of one of bands 2 to 4
+    void attachBandControls(int band);
+
+    // Juce Contrl variables
+    
+    juce::Slider delayTimeSlider;
+    juce::Slider feedbackSlider;
+    juce::Slider gainSlider;
+    juce::Slider mixingSlider;
+    juce::Slider offsetLSlider;
+    juce::Slider offsetRSlider;
+    juce::Slider tapCountSlider;
+    juce::Slider tapDecaySlider;
+    juce::Slider tapSpreadSlider;
+    juce::Slider feedbackRotationSlider;
+    juce::Slider lowCutSlider;
+    juce::Slider highCutSlider;
+    juce::Slider tiltSlider;
+    juce::Slider diffusionSlider;
+    juce::Slider modRateSlider;
+    juce::Slider modDepthSlider;
+    juce::Slider modPhaseSlider;
+    juce::Slider modDriftSlider;
+    juce::Slider morphSlider;
+    juce::Slider morphTargetSlider;
+    juce::Slider loopTimeSlider;
+    juce::Slider bandsSlider;
+    juce::Slider crossover1Slider;
+    juce::Slider crossover2Slider;
+    juce::Slider crossover3Slider;
+    juce::Slider bandDelayTimeSlider;
+    juce::Slider bandFeedbackSlider;
+    juce::Slider bandOffsetLSlider;
+    juce::Slider bandOffsetRSlider;
+    juce::ToggleButton bypassButton;
+    juce::ToggleButton longDelayButton{ "Long Delay" };
+    juce::ComboBox effectsCombo;
+    juce::ComboBox tempoSyncCombo;
+    juce::ComboBox interpolationCombo;
+    juce::ComboBox feedbackRoutingCombo;
+    juce::ComboBox bandSelectCombo;
+
+
+    // Text String variables
+    
+    juce::Label delayTimeLabel;
+    juce::Label feedbackLabel;
+    juce::Label gainLabel;
+    juce::Label mixingLabel;
+    juce::Label offsetLLabel;
+    juce::Label offsetRLabel;
+    juce::Label bypassLabel;
+    juce::Label titleLabel;
+    juce::Label tapCountLabel;
+    juce::Label tapDecayLabel;
+    juce::Label tapSpreadLabel;
+    juce::Label feedbackRotationLabel;
+    juce::Label lowCutLabel;
+    juce::Label highCutLabel;
+    juce::Label tiltLabel;
+    juce::Label diffusionLabel;
+    juce::Label modRateLabel;
+    juce::Label modDepthLabel;
+    juce::Label modPhaseLabel;
+    juce::Label modDriftLabel;
+    juce::Label morphLabel;
+    juce::Label loopTimeLabel;
+    juce::Label bandsLabel;
+    juce::Label bandSelectLabel;
+    juce::Label crossover1Label;
+    juce::Label crossover2Label;
+    juce::Label crossover3Label;
+    juce::Label bandDelayTimeLabel;
+    juce::Label bandFeedbackLabel;
+    juce::Label bandOffsetLLabel;
+    juce::Label bandOffsetRLabel;
+
+
+    // Scalar values of the Attachments
+    
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> delayTimeValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> feedbackValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> gainValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> mixingValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> offsetLValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> offsetRValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> tapCountValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> tapDecayValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> tapSpreadValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> feedbackRotationValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> lowCutValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> highCutValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> tiltValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> diffusionValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> modRateValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> modDepthValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> modPhaseValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> modDriftValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> morphValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> morphTargetValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> loopTimeValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ButtonAttachment> longDelayValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> bandsValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> crossover1Value;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> crossover2Value;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> crossover3Value;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> bandDelayTimeValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> bandFeedbackValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> bandOffsetLValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> bandOffsetRValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ButtonAttachment> bypassValue;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> effectsChoice;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> tempoSyncChoice;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> interpolationChoice;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> feedbackRoutingChoice;
+    
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TableTennisAudioProcessorEditor)
+};
@@ -1,407 +1,1134 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-TableTennisAudioProcessor::TableTennisAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       ), treeState(*this, nullptr, juce::Identifier("PARAMETERS"),
-                           { std::make_unique<juce::AudioParameterFloat>("delayTime", "Delay (samples)", 10.f, 5000.f, 1.f), // changed to 10 to stop feedback being heard at 0.
-                             std::make_unique<juce::AudioParameterFloat>("feedback", "Feedback 0-1", 0.f, 0.99f, 0.3f),
-                             std::make_unique<juce::AudioParameterFloat>("gain", "Gain", 0.f, 1.f, 0.01f),
-                             std::make_unique<juce::AudioParameterFloat>("offsetL", "OffsetL", 0.f, 1000.f, 1.f),
-                             std::make_unique<juce::AudioParameterFloat>("offsetR", "OffsetR", 0.f, 1000.f, 1.f),
-                             std::make_unique<juce::AudioParameterFloat>("mix", "Mix", 0.f, 1.f, 0.01f), // starts off at my dry signal
-                             std::make_unique<juce::AudioParameterBool>("audioBypass", "Audio Bypass", false),
-                             //std::make_unique<juce::AudioParameterChoice>("effectsMode", "Effect Mode", juce::StringArray("ping", "delay", "experimental"), 0),
-                           })
-#endif
-{
-
-    const juce::StringArray params = { "delayTime","feedback","gain", "mix", "offsetL", "offsetR", "audioBypass"}; // "effectsMode"
-    for (int i = 0; i <= 7; ++i)
-    {
-        treeState.addParameterListener(params[i], this);
-    }
-
-    /*
-    treeState.addParameterListener("delayTime", this);
-    treeState.addParameterListener("feedback", this);
-    treeState.addParameterListener("gain", this);
-    treeState.addParameterListener("mix", this);
-    treeState.addParameterListener("offsetL", this);
-    treeState.addParameterListener("offsetR", this);
-    treeState.addParameterListener("audioBypass", this);
-    treeState.addParameterListener("effectsMode", this);
-    */
-
-   // panPosition = new juce::AudioParameterFloat("panPosition", "Pan Position", -1.0f, 1.0f, 0.0f);
-   // addParameter(panPosition);
-}
-
-TableTennisAudioProcessor::~TableTennisAudioProcessor()
-{
-}
-
-//==============================================================================
-const juce::String TableTennisAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool TableTennisAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool TableTennisAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool TableTennisAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double TableTennisAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int TableTennisAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int TableTennisAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void TableTennisAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String TableTennisAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void TableTennisAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void TableTennisAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-
-    {
-        /*
-        The Following code utilises DSP module classes;
-
-            This code provides detail about the contextualisation in
-            which the coding will be calling: Sampling rate and
-            Samples per Block
-
-        This is important because they DelayLine class needs to initialise
-        with an interal circular buffer with the correct number of channels.
-        */
-
-        juce::dsp::ProcessSpec spec;
-
-        spec.sampleRate = sampleRate;
-        spec.maximumBlockSize = samplesPerBlock;
-        spec.numChannels = getTotalNumOutputChannels();
-
-        mDelayLine.reset();
-        mDelayLine.prepare(spec);
-    }
-}
-
-void TableTennisAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool TableTennisAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void TableTennisAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    // In case we have more outputs than inputs, this code clears any output
-    // channels that didn't contain input data, (because these aren't
-    // guaranteed to be empty - they may contain garbage).
-
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear(i, 0, buffer.getNumSamples());
-
-    // Sets individual Writing Pointers into each channel.
-
-    auto* channelDataL = buffer.getWritePointer(0);
-    auto* channelDataR = buffer.getWritePointer(1);
-
-
-    if (mBypass == false)
-    {
-        //if (mEffectChoice == 1) // Ping-Pong Delay
-        //{
-            // 1. Loop runs from 0 to get the number of samples in the block
-
-            for (int i = 0; i < buffer.getNumSamples(); i++)
-
-            {
-                /*
-                    1 The process below allows for the addition for feedback to our sample.
-
-                    This is a basic PingPong Delay
-
-                    1. Retrieve's the input sample value from the input output buffer
-                    Then assign a local variable name 'in'.
-
-                    2. 'pop's a sample from the delayLine buffer on the specified channel and assigning
-                    to a local variable named 'temp'.
-
-                    The sample that we read from delayLine is determined by 'mDelayTime'
-                    which stores the value from the UI controls.
-
-                    Upon calling 'popSample', it updates the read index position
-                    in the buffer automatically.
-
-                    3. 'Push' a sample into the delayLine buffer. The value that we
-                    write is equal to the input (in) audio sample mixed with the delayed
-                    sample that has just popped from the delayLine buffer scaled by the
-                    feedback amount.
-
-                    4. Finally, the input/output buffer of the delayed
-                    sample accumulated with the input sample. The output is equal to the
-                    delayed signal that is mixed with the original input signal. They are
-                    summing two signal values that are scaled by the user and can be controlled
-                    by the gain parameter. The implementation of a Dry-Wet control through the 
-                    use of the dial in the UI. Giving the user control over how much wet signal 
-                    they want or how little.  
-                */
-
-                float inL = channelDataL[i]; // 1
-                float inR = channelDataR[i];
-
-                float temp1 = mDelayLine.popSample(0, mDelayTime + mOffsetL, true); // 2 The addition of 'false' won't implement the channel and give a dry mix option.
-                float temp2 = mDelayLine.popSample(1, mDelayTime + mOffsetR, true);
-
-                mDelayLine.pushSample(0, inL + (temp2 * mFeedback)); // 3
-                mDelayLine.pushSample(1, inR + (temp1 * mFeedback));
-
-                channelDataL[i] = ((inL * (1 - mMix)) + (temp2 * mMix)) * mVolume; //4 
-                channelDataR[i] = ((inR * (1 - mMix)) + (temp1 * mMix)) * mVolume;
-            }
-        //}
-
-         /*
-        else if (mEffectChoice == 2) // - Standard delay module
-        {
-            for (int i = 0; i < buffer.getNumSamples(); i++)
-            {
-                float inL = channelDataL[i]; // 1
-                float inR = channelDataR[i];
-
-                float temp1 = mDelayLine.popSample(0, mDelayTime, true); // 2 The addition of 'false' won't implement the channel and give a dry mix option.
-                float temp2 = mDelayLine.popSample(1, mDelayTime, true);
-
-                mDelayLine.pushSample(0, inL + (temp2 * mFeedback)); // 3
-                mDelayLine.pushSample(1, inR + (temp1 * mFeedback));
-
-                //channelDataL[i] = (inL + temp2) * mVolume; // 4
-                //channelDataR[i] = (inR + temp1) * mVolume;
-            }
-        }
-
-       
-        else if (mEffectChoice == 3) // - Echo effect (attempt)
-
-        {
-            for (int i = 0; i < buffer.getNumSamples(); i++)
-            {
-                float inL = channelDataL[i];
-                float inR = channelDataR[i];
-
-                float temp1 = mDelayLine.popSample(0, mDelayTime, true); // 2 The addition of 'false' won't implement the channel and give a dry mix option.
-                float temp2 = mDelayLine.popSample(0, mDelayTime + 250.f, false);
-                float temp3 = mDelayLine.popSample(0, mDelayTime + 500.f, false);
-
-                float temp4 = mDelayLine.popSample(1, mDelayTime, true);
-                float temp5 = mDelayLine.popSample(1, mDelayTime + 250.f, false);
-                float temp6 = mDelayLine.popSample(1, mDelayTime + 250.f, false);
-
-                mDelayLine.pushSample(0, inL + (temp4 * mFeedback) + (temp5 * mFeedback) + (temp6 * mFeedback)); // 3
-                mDelayLine.pushSample(1, inR + (temp1 * mFeedback) + (temp2 * mFeedback) + (temp3 * mFeedback));
-
-                //channelDataL[i] = (inL + temp2) * mVolume; // 4
-                //channelDataR[i] = (inR + temp1) * mVolume;
-            }
-        } */  
-    
-    }
-    
-    // Bypass Control - does what it says on the tin
-
-    else if (mBypass == true)
-    {
-        for (int i = 0; i < buffer.getNumSamples(); i++)
-        {
-            channelDataL[i] = channelDataL[i] * 0;
-            channelDataR[i] = channelDataR[i] * 0;
-        }
-    }
-}
-
-//==============================================================================
-bool TableTennisAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* TableTennisAudioProcessor::createEditor()
-{
-    return new TableTennisAudioProcessorEditor (*this, treeState);
-}
-
-//==============================================================================
-void TableTennisAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    auto state = treeState.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
-
-    // Gets the values from the last session and uses them in the current one
-}
-
-void TableTennisAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
-
-    if (xmlState.get() != nullptr)
-        if (xmlState->hasTagName(treeState.state.getType()))
-            treeState.replaceState(juce::ValueTree::fromXml(*xmlState));
-
-    // Saves values from the users input and stores them till the next session
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new TableTennisAudioProcessor();
-}
-
-// Function called when parameter is changed
-void TableTennisAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
-{
-
-    // Ping Pong delay parameter values
-
-    if (parameterID == "delayTime")
-    {
-        mDelayTime = newValue;
-    }
-
-    else if (parameterID == "feedback")
-    {
-        mFeedback = newValue;
-    }
-
-    else if (parameterID == "gain")
-    {
-        mVolume = newValue; 
-    }
-
-    else if (parameterID == "offsetL")
-    {
-        mOffsetL = newValue;
-    }
-
-    else if (parameterID == "offsetR")
-    {
-        mOffsetL = newValue;
-    }
-
-    else if (parameterID == "mix")
-    {
-        mMix = newValue;
-    }
-       
-    // Bypass Parameter values 
-
-    else if (parameterID == "audioBypass")
-    {
-        mBypass = newValue;
-    }
-    // Has a bug where you have to bypass the system first before being able to use it.
-    //      Almost as if it was resetting the system.
-
-
-    //else if (parameterID == "effectsMode")
-    //{
-    //    mEffectChoice = newValue;
-    // 
-    //}
-    /*
-        Has a bug where it's implementation affects different parts of the delay module.
-    Resulting in it being put on a back burner for now till it's either being troubleshot or 
-    is taken off.
-    */
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+/*
+    Note divisions for the "tempoSync" parameter. Index 0 leaves the delay time
+    free running, the rest are lengths in quarter notes (beats).
+*/
+static const juce::StringArray noteDivisionNames = { "Free", "1/1", "1/2", "1/4", "1/4.", "1/8", "1/8.", "1/8T", "1/16" };
+static constexpr double noteDivisionBeats[] = { 0.0, 4.0, 2.0, 1.0, 1.5, 0.5, 0.75, 1.0 / 3.0, 0.25 };
+
+/*
+    Modes for the "effectsMode" parameter, in the same order as PingPongKernelBase::Mode
+*/
+static const juce::StringArray effectModeNames = { "Ping Pong Delay", "Delay", "Multi-Tap Echo" };
+
+/*
+    Delay read quality for the "interpolation" parameter, in the same order as
+    DelayInterpolation::Type. "HQ Sinc" is meant for offline renders.
+*/
+static const juce::StringArray interpolationNames = { "None", "Linear", "Lagrange", "Thiran", "HQ Sinc" };
+
+/*
+    How the feedback moves between the channels, for the "feedbackRouting"
+    parameter. "Rotate" sends each channel into the one "feedbackRotation"
+    places before it, "Matrix" mixes them all through the feedback matrix.
+*/
+static const juce::StringArray feedbackRoutingNames = { "Rotate", "Matrix" };
+
+/*
+    Morphing between programs; the continuous values glide from one to the
+    other, and the choices jump across half way.
+*/
+static float morphValue(float from, float to, float amount) noexcept { return from + amount * (to - from); }
+static int   morphValue(int from, int to, float amount) noexcept     { return amount < 0.5f ? from : to; }
+
+/*
+    Where the long delay mode keeps its scratch file; TABLETENNIS_SCRATCH_DIR
+    if it is set, so it can be pointed at a fast local disk, or the system's
+    temporary folder.
+*/
+static std::string getScratchDirectory()
+{
+    auto directory = juce::SystemStats::getEnvironmentVariable("TABLETENNIS_SCRATCH_DIR", {});
+
+    if (directory.isEmpty())
+        directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getFullPathName();
+
+    return directory.toStdString();
+}
+
+/*
+    States saved as XML come from before the binary format, when delayTime and
+    the offsets were counted in samples (delayTime from 10 to 5000) rather than
+    milliseconds. Those builds never saved the sample rate, so the samples are
+    taken at the rate the processor runs at, which is 44.1 kHz until the host
+    has called prepareToPlay.
+*/
+static void convertLegacyDelayUnits(juce::XmlElement& xml, double sampleRate)
+{
+    for (auto* param = xml.getFirstChildElement(); param != nullptr; param = param->getNextElement())
+    {
+        auto id = param->getStringAttribute("id");
+
+        if (param->hasTagName("PARAM") && (id == "delayTime" || id == "offsetL" || id == "offsetR"))
+            param->setAttribute("value", param->getDoubleAttribute("value") * 1000.0 / sampleRate);
+    }
+}
+
+static void setField(float& field, float value) noexcept { field = value; }
+static void setField(int& field, float value) noexcept   { field = juce::roundToInt(value); }
+
+//==============================================================================
+TableTennisAudioProcessor::TableTennisAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       ), treeState(*this, nullptr, juce::Identifier("PARAMETERS"),
+                           { std::make_unique<juce::AudioParameterFloat>("delayTime", "Delay (ms)", 1.f, maxDelayTimeMs, 250.f), // starts at 1ms to stop feedback being heard at 0.
+                             std::make_unique<juce::AudioParameterFloat>("feedback", "Feedback 0-1", 0.f, 0.99f, 0.3f),
+                             std::make_unique<juce::AudioParameterFloat>("gain", "Gain", 0.f, 1.f, 0.01f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetL", "OffsetL (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetR", "OffsetR (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("mix", "Mix", 0.f, 1.f, 0.01f), // starts off at my dry signal
+                             std::make_unique<juce::AudioParameterBool>("audioBypass", "Audio Bypass", false),
+                             std::make_unique<juce::AudioParameterChoice>("tempoSync", "Tempo Sync", noteDivisionNames, 0),
+                             std::make_unique<juce::AudioParameterChoice>("effectsMode", "Effect Mode", effectModeNames, 0),
+                             std::make_unique<juce::AudioParameterInt>("tapCount", "Echo Taps", 1, PingPongKernelBase::maxTaps, 4),
+                             std::make_unique<juce::AudioParameterFloat>("tapDecay", "Echo Decay", 0.f, 1.f, 0.7f),
+                             std::make_unique<juce::AudioParameterFloat>("tapSpread", "Echo Spread", 0.f, 1.f, 1.f),
+                             std::make_unique<juce::AudioParameterChoice>("interpolation", "Interpolation", interpolationNames, 1),
+                             std::make_unique<juce::AudioParameterChoice>("feedbackRouting", "Feedback Routing", feedbackRoutingNames, 0),
+                             std::make_unique<juce::AudioParameterInt>("feedbackRotation", "Feedback Rotation", 1, PingPongKernelBase::maxChannels - 1, 1),
+                             std::make_unique<juce::AudioParameterFloat>("lowCut", "Feedback Low Cut (Hz)", juce::NormalisableRange<float>(FeedbackFilter::lowCutOffHz, 2000.f, 1.f, 0.3f), FeedbackFilter::lowCutOffHz),
+                             std::make_unique<juce::AudioParameterFloat>("highCut", "Feedback High Cut (Hz)", juce::NormalisableRange<float>(1000.f, FeedbackFilter::highCutOffHz, 1.f, 0.3f), FeedbackFilter::highCutOffHz),
+                             std::make_unique<juce::AudioParameterFloat>("tilt", "Feedback Tilt (dB)", -6.f, 6.f, 0.f),
+                             std::make_unique<juce::AudioParameterFloat>("modRate", "Mod Rate (Hz)", juce::NormalisableRange<float>(0.05f, 10.f, 0.01f, 0.3f), 0.5f),
+                             std::make_unique<juce::AudioParameterFloat>("modDepth", "Mod Depth (ms)", 0.f, maxModDepthMs, 0.f), // no modulation by default
+                             std::make_unique<juce::AudioParameterFloat>("modPhase", "Mod Phase (deg)", 0.f, 360.f, 90.f),
+                             std::make_unique<juce::AudioParameterFloat>("modDrift", "Mod Drift", 0.f, 1.f, 0.f),
+                             std::make_unique<juce::AudioParameterFloat>("diffusion", "Diffusion", 0.f, 1.f, 0.f), // clean repeats by default
+                             std::make_unique<juce::AudioParameterBool>("longDelay", "Long Delay", false),
+                             std::make_unique<juce::AudioParameterFloat>("loopTime", "Loop Time (s)", juce::NormalisableRange<float>(1.f, maxLoopTimeSeconds, 0.1f, 0.4f), 30.f),
+                             std::make_unique<juce::AudioParameterFloat>("morph", "Program Morph", 0.f, 1.f, 0.f),
+                             std::make_unique<juce::AudioParameterInt>("morphTarget", "Morph Target", 1, ProgramBank<ParameterSnapshot>::maxPrograms, 1),
+                             std::make_unique<juce::AudioParameterInt>("bands", "Bands", 1, PingPongEngine::maxBands, 1), // one band is the plain ping-pong
+                             std::make_unique<juce::AudioParameterFloat>("crossover1", "Crossover 1 (Hz)", juce::NormalisableRange<float>(40.f, 16000.f, 1.f, 0.3f), 250.f),
+                             std::make_unique<juce::AudioParameterFloat>("crossover2", "Crossover 2 (Hz)", juce::NormalisableRange<float>(40.f, 16000.f, 1.f, 0.3f), 1500.f),
+                             std::make_unique<juce::AudioParameterFloat>("crossover3", "Crossover 3 (Hz)", juce::NormalisableRange<float>(40.f, 16000.f, 1.f, 0.3f), 6000.f),
+                             std::make_unique<juce::AudioParameterFloat>("delayTime2", "Band 2 Delay (ms)", 1.f, maxDelayTimeMs, 250.f),
+                             std::make_unique<juce::AudioParameterFloat>("feedback2", "Band 2 Feedback", 0.f, 0.99f, 0.3f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetL2", "Band 2 OffsetL (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetR2", "Band 2 OffsetR (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("delayTime3", "Band 3 Delay (ms)", 1.f, maxDelayTimeMs, 250.f),
+                             std::make_unique<juce::AudioParameterFloat>("feedback3", "Band 3 Feedback", 0.f, 0.99f, 0.3f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetL3", "Band 3 OffsetL (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetR3", "Band 3 OffsetR (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("delayTime4", "Band 4 Delay (ms)", 1.f, maxDelayTimeMs, 250.f),
+                             std::make_unique<juce::AudioParameterFloat>("feedback4", "Band 4 Feedback", 0.f, 0.99f, 0.3f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetL4", "Band 4 OffsetL (ms)", 0.f, maxOffsetMs, 1.f),
+                             std::make_unique<juce::AudioParameterFloat>("offsetR4", "Band 4 OffsetR (ms)", 0.f, maxOffsetMs, 1.f),
+                           })
+#endif
+{
+
+    /*
+    Caches the raw value handles, so the audio thread never has to look a
+    parameter up by its name.
+    */
+
+    mDelayTimeParam = treeState.getRawParameterValue("delayTime");
+    mFeedbackParam = treeState.getRawParameterValue("feedback");
+    mGainParam = treeState.getRawParameterValue("gain");
+    mOffsetLParam = treeState.getRawParameterValue("offsetL");
+    mOffsetRParam = treeState.getRawParameterValue("offsetR");
+    mMixParam = treeState.getRawParameterValue("mix");
+    mBypassParam = treeState.getRawParameterValue("audioBypass");
+    mTempoSyncParam = treeState.getRawParameterValue("tempoSync");
+    mEffectsModeParam = treeState.getRawParameterValue("effectsMode");
+    mTapCountParam = treeState.getRawParameterValue("tapCount");
+    mTapDecayParam = treeState.getRawParameterValue("tapDecay");
+    mTapSpreadParam = treeState.getRawParameterValue("tapSpread");
+    mInterpolationParam = treeState.getRawParameterValue("interpolation");
+    mFeedbackRoutingParam = treeState.getRawParameterValue("feedbackRouting");
+    mFeedbackRotationParam = treeState.getRawParameterValue("feedbackRotation");
+    mLowCutParam = treeState.getRawParameterValue("lowCut");
+    mHighCutParam = treeState.getRawParameterValue("highCut");
+    mTiltParam = treeState.getRawParameterValue("tilt");
+    mModRateParam = treeState.getRawParameterValue("modRate");
+    mModDepthParam = treeState.getRawParameterValue("modDepth");
+    mModPhaseParam = treeState.getRawParameterValue("modPhase");
+    mModDriftParam = treeState.getRawParameterValue("modDrift");
+    mDiffusionParam = treeState.getRawParameterValue("diffusion");
+    mLongDelayParam = treeState.getRawParameterValue("longDelay");
+    mLoopTimeParam = treeState.getRawParameterValue("loopTime");
+    mMorphParam = treeState.getRawParameterValue("morph");
+    mMorphTargetParam = treeState.getRawParameterValue("morphTarget");
+    mBandsParam = treeState.getRawParameterValue("bands");
+
+    for (int i = 0; i < PingPongEngine::maxBands - 1; ++i)
+    {
+        auto band = juce::String(i + 2);
+
+        mCrossoverParams[(size_t) i] = treeState.getRawParameterValue("crossover" + juce::String(i + 1));
+        mBandDelayTimeParams[(size_t) i] = treeState.getRawParameterValue("delayTime" + band);
+        mBandFeedbackParams[(size_t) i] = treeState.getRawParameterValue("feedback" + band);
+        mBandOffsetLParams[(size_t) i] = treeState.getRawParameterValue("offsetL" + band);
+        mBandOffsetRParams[(size_t) i] = treeState.getRawParameterValue("offsetR" + band);
+    }
+
+    // The factory bank, ahead of any user programs a saved state brings in
+    addFactoryPrograms();
+    startTimerHz(30);
+
+    // Only started when the environment asks for it; see TelemetryDumper
+    mTelemetryDumper = TelemetryDumper::createFromEnvironment(mTelemetry);
+
+   // panPosition = new juce::AudioParameterFloat("panPosition", "Pan Position", -1.0f, 1.0f, 0.0f);
+   // addParameter(panPosition);
+}
+
+TableTennisAudioProcessor::~TableTennisAudioProcessor()
+{
+    stopTimer();
+}
+
+//==============================================================================
+const juce::String TableTennisAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool TableTennisAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool TableTennisAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool TableTennisAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double TableTennisAudioProcessor::getTailLengthSeconds() const
+{
+    return getTailLengthSeconds(getParameterSnapshot());
+}
+
+int TableTennisAudioProcessor::getNumPrograms()
+{
+    return mPrograms.getNumPrograms();   // Always at least the factory ones
+}
+
+int TableTennisAudioProcessor::getCurrentProgram()
+{
+    return mCurrentProgram.load();
+}
+
+void TableTennisAudioProcessor::setCurrentProgram (int index)
+{
+    // No allocation and no locks, as a program change may come from any thread
+    if (juce::isPositiveAndBelow(index, mPrograms.getNumPrograms()))
+    {
+        mCurrentProgram.store(index);
+        mProgramOverride.store(index, std::memory_order_release);
+    }
+}
+
+const juce::String TableTennisAudioProcessor::getProgramName (int index)
+{
+    return mPrograms.getName(index);
+}
+
+void TableTennisAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+    mPrograms.setName(index, newName);  // Factory programs keep their names
+}
+
+int TableTennisAudioProcessor::saveProgram(const juce::String& name)
+{
+    auto index = mPrograms.addProgram(name, readParameterValues());
+
+    if (index >= 0)
+        mCurrentProgram.store(index);
+
+    return index;
+}
+
+//==============================================================================
+template <typename Function>
+void TableTennisAudioProcessor::forEachProgramField(Function&& function)
+{
+    /*
+        The settings a program holds, by parameter ID. Bypass, the morph
+        controls and the long delay mode (which re-sizes the delay lines)
+        belong to the session, not to a program, so aren't here.
+    */
+
+    function("delayTime", &ParameterSnapshot::delayTime);
+    function("feedback", &ParameterSnapshot::feedback);
+    function("gain", &ParameterSnapshot::gain);
+    function("offsetL", &ParameterSnapshot::offsetL);
+    function("offsetR", &ParameterSnapshot::offsetR);
+    function("mix", &ParameterSnapshot::mix);
+    function("tempoSync", &ParameterSnapshot::tempoSync);
+    function("effectsMode", &ParameterSnapshot::effectsMode);
+    function("tapCount", &ParameterSnapshot::tapCount);
+    function("tapDecay", &ParameterSnapshot::tapDecay);
+    function("tapSpread", &ParameterSnapshot::tapSpread);
+    function("interpolation", &ParameterSnapshot::interpolation);
+    function("feedbackRouting", &ParameterSnapshot::feedbackRouting);
+    function("feedbackRotation", &ParameterSnapshot::feedbackRotation);
+    function("lowCut", &ParameterSnapshot::lowCut);
+    function("highCut", &ParameterSnapshot::highCut);
+    function("tilt", &ParameterSnapshot::tilt);
+    function("modRate", &ParameterSnapshot::modRate);
+    function("modDepth", &ParameterSnapshot::modDepth);
+    function("modPhase", &ParameterSnapshot::modPhase);
+    function("modDrift", &ParameterSnapshot::modDrift);
+    function("diffusion", &ParameterSnapshot::diffusion);
+    function("bands", &ParameterSnapshot::bands);
+    function("crossover1", &ParameterSnapshot::crossover1);
+    function("crossover2", &ParameterSnapshot::crossover2);
+    function("crossover3", &ParameterSnapshot::crossover3);
+    function("delayTime2", &ParameterSnapshot::delayTime2);
+    function("feedback2", &ParameterSnapshot::feedback2);
+    function("offsetL2", &ParameterSnapshot::offsetL2);
+    function("offsetR2", &ParameterSnapshot::offsetR2);
+    function("delayTime3", &ParameterSnapshot::delayTime3);
+    function("feedback3", &ParameterSnapshot::feedback3);
+    function("offsetL3", &ParameterSnapshot::offsetL3);
+    function("offsetR3", &ParameterSnapshot::offsetR3);
+    function("delayTime4", &ParameterSnapshot::delayTime4);
+    function("feedback4", &ParameterSnapshot::feedback4);
+    function("offsetL4", &ParameterSnapshot::offsetL4);
+    function("offsetR4", &ParameterSnapshot::offsetR4);
+}
+
+TableTennisAudioProcessor::ParameterSnapshot TableTennisAudioProcessor::morphSnapshots(const ParameterSnapshot& from, const ParameterSnapshot& to, float amount) noexcept
+{
+    auto result = from;
+
+    forEachProgramField([&](const char*, auto field) { result.*field = morphValue(from.*field, to.*field, amount); });
+
+    return result;
+}
+
+TableTennisAudioProcessor::ParameterSnapshot TableTennisAudioProcessor::getDefaultSnapshot() const
+{
+    ParameterSnapshot snapshot;
+
+    forEachProgramField([&](const char* id, auto field)
+    {
+        if (auto* parameter = treeState.getParameter(id))
+            setField(snapshot.*field, parameter->convertFrom0to1(parameter->getDefaultValue()));
+    });
+
+    return snapshot;
+}
+
+void TableTennisAudioProcessor::addFactoryPrograms()
+{
+    /*
+        The factory bank. Each program starts from the parameter defaults
+        and changes what it needs to; index 0 is the defaults themselves.
+    */
+
+    auto init = getDefaultSnapshot();
+    mPrograms.addProgram("Init", init);
+
+    auto slapback = init;
+    slapback.effectsMode = 1;               // Delay
+    slapback.delayTime = 95.f;
+    slapback.offsetL = slapback.offsetR = 0.f;
+    slapback.feedback = 0.1f;
+    slapback.mix = 0.35f;
+    slapback.gain = 1.f;
+    mPrograms.addProgram("Slapback", slapback);
+
+    auto pingPong = init;
+    pingPong.tempoSync = 6;                 // 1/8.
+    pingPong.feedback = 0.5f;
+    pingPong.mix = 0.4f;
+    pingPong.gain = 1.f;
+    pingPong.highCut = 8000.f;
+    mPrograms.addProgram("Dotted Ping Pong", pingPong);
+
+    auto tape = init;
+    tape.delayTime = 350.f;
+    tape.feedback = 0.6f;
+    tape.mix = 0.4f;
+    tape.gain = 1.f;
+    tape.lowCut = 120.f;
+    tape.highCut = 3000.f;
+    tape.tilt = -3.f;
+    tape.modRate = 0.4f;
+    tape.modDepth = 2.f;
+    tape.modDrift = 0.6f;
+    mPrograms.addProgram("Dark Tape", tape);
+
+    auto chorus = init;
+    chorus.effectsMode = 1;
+    chorus.delayTime = 20.f;
+    chorus.offsetL = chorus.offsetR = 0.f;
+    chorus.feedback = 0.15f;
+    chorus.mix = 0.5f;
+    chorus.gain = 1.f;
+    chorus.modRate = 0.8f;
+    chorus.modDepth = 4.f;
+    chorus.modPhase = 90.f;
+    mPrograms.addProgram("Chorus Echo", chorus);
+
+    auto taps = init;
+    taps.effectsMode = 2;                   // Multi-Tap Echo
+    taps.tempoSync = 3;                     // 1/4
+    taps.tapCount = 6;
+    taps.tapDecay = 0.8f;
+    taps.feedback = 0.35f;
+    taps.mix = 0.4f;
+    taps.gain = 1.f;
+    mPrograms.addProgram("Rhythmic Taps", taps);
+
+    auto wash = init;
+    wash.delayTime = 600.f;
+    wash.offsetR = 37.f;
+    wash.feedback = 0.85f;
+    wash.mix = 0.45f;
+    wash.gain = 1.f;
+    wash.lowCut = 200.f;
+    wash.highCut = 6000.f;
+    wash.feedbackRouting = 1;               // Matrix
+    wash.modDepth = 1.5f;
+    wash.modRate = 0.2f;
+    wash.diffusion = 0.6f;
+    mPrograms.addProgram("Ambient Wash", wash);
+
+    auto split = init;
+    split.bands = 3;                        // Lows, mids and highs bouncing at their own rates
+    split.crossover1 = 300.f;
+    split.crossover2 = 3000.f;
+    split.delayTime = 500.f;
+    split.feedback = 0.3f;
+    split.delayTime2 = 375.f;
+    split.feedback2 = 0.45f;
+    split.offsetR2 = 20.f;
+    split.delayTime3 = 125.f;
+    split.feedback3 = 0.6f;
+    split.offsetL3 = 15.f;
+    split.mix = 0.4f;
+    split.gain = 1.f;
+    mPrograms.addProgram("Split Bands", split);
+
+    mPrograms.lockFactoryPrograms();
+}
+
+juce::MemoryBlock TableTennisAudioProcessor::writeUserPrograms() const
+{
+    /*
+        The current program and the user programs, for the state's
+        extension. Every value is stored with its parameter ID hash, like
+        the parameters themselves, so programs survive parameters being
+        added or removed.
+    */
+
+    juce::MemoryBlock data;
+    juce::MemoryOutputStream stream(data, false);
+
+    stream.writeInt(mCurrentProgram.load());
+    stream.writeInt(mPrograms.getNumPrograms() - mPrograms.getNumFactoryPrograms());
+
+    for (int index = mPrograms.getNumFactoryPrograms(); index < mPrograms.getNumPrograms(); ++index)
+    {
+        ParameterSnapshot values;
+        mPrograms.readValues(index, values);
+
+        auto numFields = 0;
+
+        forEachProgramField([&](const char*, auto) { ++numFields; });
+
+        stream.writeString(mPrograms.getName(index));
+        stream.writeInt(numFields);
+
+        forEachProgramField([&](const char* id, auto field)
+        {
+            stream.writeInt((int) BinaryState::hashParameterID(id));
+            stream.writeFloat((float) (values.*field));
+        });
+    }
+
+    stream.flush();
+    return data;
+}
+
+void TableTennisAudioProcessor::readUserPrograms(const juce::MemoryBlock& data)
+{
+    /*
+        The programs are all read first, and then replace the old ones slot by
+        slot, so the audio thread (which may be morphing towards one of them)
+        never finds a slot missing or half written.
+    */
+
+    struct UserProgram
+    {
+        juce::String name;
+        ParameterSnapshot values;
+    };
+
+    std::vector<UserProgram> programs;
+    juce::MemoryInputStream stream(data, false);
+
+    if (stream.getNumBytesRemaining() < 8)
+    {
+        mPrograms.setUserPrograms(programs.data(), 0);
+        mCurrentProgram.store(0);
+        return;
+    }
+
+    auto currentProgram = stream.readInt();
+    auto numPrograms = juce::jmin(stream.readInt(), ProgramBank<ParameterSnapshot>::maxPrograms);
+
+    for (int i = 0; i < numPrograms && ! stream.isExhausted(); ++i)
+    {
+        auto name = stream.readString();
+        auto numFields = stream.readInt();
+        auto values = getDefaultSnapshot();
+
+        for (int j = 0; j < numFields && ! stream.isExhausted(); ++j)
+        {
+            auto id = (juce::uint32) stream.readInt();
+            auto value = stream.readFloat();
+
+            forEachProgramField([&](const char* fieldId, auto field)
+            {
+                if (BinaryState::hashParameterID(fieldId) == id)
+                    setField(values.*field, value);
+            });
+        }
+
+        programs.push_back({ name, values });
+    }
+
+    mPrograms.setUserPrograms(programs.data(), (int) programs.size());
+
+    // The parameters came with the state, so the current program is only a label here
+    mCurrentProgram.store(juce::isPositiveAndBelow(currentProgram, mPrograms.getNumPrograms()) ? currentProgram : 0);
+}
+
+void TableTennisAudioProcessor::timerCallback()
+{
+    updateEngineLayout();
+
+    /*
+        Brings the parameters into line with a program the audio thread has
+        already switched to, then hands control back to them. If another
+        program came in meanwhile, its override is left for the next tick.
+    */
+
+    auto program = mProgramOverride.load(std::memory_order_acquire);
+    ParameterSnapshot values;
+
+    if (program == noProgram)
+        return;
+
+    if (mPrograms.readValues(program, values))
+    {
+        forEachProgramField([&](const char* id, auto field)
+        {
+            if (auto* parameter = treeState.getParameter(id))
+            {
+                auto value = parameter->convertTo0to1((float) (values.*field));
+
+                if (value != parameter->getValue())
+                    parameter->setValueNotifyingHost(value);
+            }
+        });
+    }
+
+    mProgramOverride.compare_exchange_strong(program, noProgram);
+}
+
+void TableTennisAudioProcessor::updateEngineLayout()
+{
+    /*
+        Switching the long delay mode sizes the delay lines again (and maybe
+        moves them to disk), which the audio thread can't do. So the
+        processing is held off while the engine is prepared again here, on
+        the message thread, and starts back from silence. The bands never
+        come through here; their lines were all taken in prepareToPlay().
+    */
+
+    if (mPreparedBlockSize == 0)
+        return;
+
+    auto longDelay = mLongDelayParam->load() >= 0.5f;
+
+    if (longDelay == mEngine.isLongDelayMode())
+        return;
+
+    suspendProcessing(true);
+
+    mEngine.setLongDelayMode(longDelay, getScratchDirectory());
+    mEngine.prepare(mSampleRate, mPreparedBlockSize, mNumChannels, getProcessingPrecision() == doublePrecision);
+
+    suspendProcessing(false);
+}
+
+int TableTennisAudioProcessor::getBandsParameter() const noexcept
+{
+    return juce::jlimit(1, PingPongEngine::maxBands, (int) mBandsParam->load(std::memory_order_relaxed));
+}
+
+//==============================================================================
+void TableTennisAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // Use this method as the place to do any pre-playback
+    // initialisation that you need..
+
+    {
+        /*
+        The Following code prepares the engine;
+
+            This code provides detail about the contextualisation in
+            which the coding will be calling: Sampling rate and
+            Samples per Block
+
+        This is important because the engine needs to initialise its
+        circular buffer, and its scratch space for a whole block.
+        It gets one delay line for every channel on the bus, in the
+        precision the host is going to process with. In the long delay
+        mode the lines are minutes long, and kept in a scratch file.
+
+        The lines for every band are taken here too, whatever the bands
+        parameter says now. Automation, a program change or a morph can
+        bring the bands in at any moment, and the audio thread has to find
+        their lines already there; only the bands in use get run.
+        */
+
+        mSampleRate = sampleRate;
+        mNumChannels = juce::jlimit(1, PingPongEngine::maxChannels, getTotalNumOutputChannels());
+        mPreparedBlockSize = samplesPerBlock;
+
+        mEngine.setLongDelayMode(mLongDelayParam->load() >= 0.5f, getScratchDirectory());
+        mEngine.setMaximumNumBands(PingPongEngine::maxBands);
+        mEngine.prepare(sampleRate, samplesPerBlock, mNumChannels, getProcessingPrecision() == doublePrecision);
+
+        mVisualiserFrame = {};
+        mVisualiserCountdown = 0;
+
+        mTelemetry.prepare(sampleRate, mNumChannels);
+    }
+
+    {
+        /*
+        Bypass crossfade; it starts wherever the switch is, so a session that
+        loads bypassed doesn't fade in. The buffer holds the dry input while
+        fading, plus one channel for the fade gains.
+        */
+
+        auto bypassed = mBypassParam->load() >= 0.5f;
+
+        mBypassFade.reset(sampleRate, 0.02);
+        mBypassFade.setCurrentAndTargetValue(bypassed ? 0.f : 1.f);
+        mBypassFlushed = false;
+
+        if (getProcessingPrecision() == doublePrecision)
+            std::get<juce::AudioBuffer<double>>(mBypassBuffers).setSize(mNumChannels + 1, samplesPerBlock);
+        else
+            std::get<juce::AudioBuffer<float>>(mBypassBuffers).setSize(mNumChannels + 1, samplesPerBlock);
+    }
+}
+
+void TableTennisAudioProcessor::setFeedbackMatrix(const float* matrix, int numChannels)
+{
+    jassert(matrix != nullptr && juce::isPositiveAndNotGreaterThan(numChannels, PingPongKernelBase::maxChannels));
+
+    numChannels = juce::jlimit(0, PingPongKernelBase::maxChannels, numChannels);
+
+    const juce::SpinLock::ScopedLockType lock(mMatrixLock);
+
+    std::copy(matrix, matrix + numChannels * numChannels, mPendingMatrix.begin());
+    mPendingMatrixSize = numChannels;
+    mMatrixChanged = true;
+}
+
+const float* TableTennisAudioProcessor::getFeedbackMatrix(int numChannels) noexcept
+{
+    {
+        // If the message thread is mid-way through a change, the old matrix is kept for one more block
+        const juce::SpinLock::ScopedTryLockType lock(mMatrixLock);
+
+        if (lock.isLocked() && mMatrixChanged)
+        {
+            mFeedbackMatrix = mPendingMatrix;
+            mFeedbackMatrixSize = mPendingMatrixSize;
+            mMatrixChanged = false;
+        }
+    }
+
+    return mFeedbackMatrixSize == numChannels ? mFeedbackMatrix.data() : nullptr;
+}
+
+TableTennisAudioProcessor::ParameterSnapshot TableTennisAudioProcessor::getParameterSnapshot() const noexcept
+{
+    /*
+        What the audio should do; the parameters, or the program just
+        switched to while they catch up, morphed towards the morph target.
+        Reading a program is a copy of its values that never waits on the
+        message thread, so this stays real-time safe.
+    */
+
+    auto snapshot = readParameterValues();
+    ParameterSnapshot program;
+
+    if (mPrograms.readValues(mProgramOverride.load(std::memory_order_acquire), program))
+        forEachProgramField([&](const char*, auto field) { snapshot.*field = program.*field; });
+
+    if (snapshot.morph > 0.f && mPrograms.readValues(snapshot.morphTarget - 1, program))
+        snapshot = morphSnapshots(snapshot, program, snapshot.morph);
+
+    return snapshot;
+}
+
+TableTennisAudioProcessor::ParameterSnapshot TableTennisAudioProcessor::readParameterValues() const noexcept
+{
+    ParameterSnapshot snapshot;
+
+    snapshot.delayTime = mDelayTimeParam->load(std::memory_order_relaxed);
+    snapshot.feedback = mFeedbackParam->load(std::memory_order_relaxed);
+    snapshot.gain = mGainParam->load(std::memory_order_relaxed);
+    snapshot.offsetL = mOffsetLParam->load(std::memory_order_relaxed);
+    snapshot.offsetR = mOffsetRParam->load(std::memory_order_relaxed);
+    snapshot.mix = mMixParam->load(std::memory_order_relaxed);
+    snapshot.bypass = mBypassParam->load(std::memory_order_relaxed) >= 0.5f;
+    snapshot.tempoSync = juce::jlimit(0, noteDivisionNames.size() - 1, (int) mTempoSyncParam->load(std::memory_order_relaxed));
+    snapshot.effectsMode = juce::jlimit(0, effectModeNames.size() - 1, (int) mEffectsModeParam->load(std::memory_order_relaxed));
+    snapshot.tapCount = juce::jlimit(1, PingPongKernelBase::maxTaps, (int) mTapCountParam->load(std::memory_order_relaxed));
+    snapshot.tapDecay = mTapDecayParam->load(std::memory_order_relaxed);
+    snapshot.tapSpread = mTapSpreadParam->load(std::memory_order_relaxed);
+    snapshot.interpolation = juce::jlimit(0, interpolationNames.size() - 1, (int) mInterpolationParam->load(std::memory_order_relaxed));
+    snapshot.feedbackRouting = juce::jlimit(0, feedbackRoutingNames.size() - 1, (int) mFeedbackRoutingParam->load(std::memory_order_relaxed));
+    snapshot.feedbackRotation = (int) mFeedbackRotationParam->load(std::memory_order_relaxed);
+    snapshot.lowCut = mLowCutParam->load(std::memory_order_relaxed);
+    snapshot.highCut = mHighCutParam->load(std::memory_order_relaxed);
+    snapshot.tilt = mTiltParam->load(std::memory_order_relaxed);
+    snapshot.modRate = mModRateParam->load(std::memory_order_relaxed);
+    snapshot.modDepth = mModDepthParam->load(std::memory_order_relaxed);
+    snapshot.modPhase = mModPhaseParam->load(std::memory_order_relaxed);
+    snapshot.modDrift = mModDriftParam->load(std::memory_order_relaxed);
+    snapshot.diffusion = mDiffusionParam->load(std::memory_order_relaxed);
+    snapshot.longDelay = mLongDelayParam->load(std::memory_order_relaxed) >= 0.5f;
+    snapshot.loopTime = mLoopTimeParam->load(std::memory_order_relaxed);
+    snapshot.morph = mMorphParam->load(std::memory_order_relaxed);
+    snapshot.morphTarget = (int) mMorphTargetParam->load(std::memory_order_relaxed);
+    snapshot.bands = getBandsParameter();
+    snapshot.crossover1 = mCrossoverParams[0]->load(std::memory_order_relaxed);
+    snapshot.crossover2 = mCrossoverParams[1]->load(std::memory_order_relaxed);
+    snapshot.crossover3 = mCrossoverParams[2]->load(std::memory_order_relaxed);
+    snapshot.delayTime2 = mBandDelayTimeParams[0]->load(std::memory_order_relaxed);
+    snapshot.feedback2 = mBandFeedbackParams[0]->load(std::memory_order_relaxed);
+    snapshot.offsetL2 = mBandOffsetLParams[0]->load(std::memory_order_relaxed);
+    snapshot.offsetR2 = mBandOffsetRParams[0]->load(std::memory_order_relaxed);
+    snapshot.delayTime3 = mBandDelayTimeParams[1]->load(std::memory_order_relaxed);
+    snapshot.feedback3 = mBandFeedbackParams[1]->load(std::memory_order_relaxed);
+    snapshot.offsetL3 = mBandOffsetLParams[1]->load(std::memory_order_relaxed);
+    snapshot.offsetR3 = mBandOffsetRParams[1]->load(std::memory_order_relaxed);
+    snapshot.delayTime4 = mBandDelayTimeParams[2]->load(std::memory_order_relaxed);
+    snapshot.feedback4 = mBandFeedbackParams[2]->load(std::memory_order_relaxed);
+    snapshot.offsetL4 = mBandOffsetLParams[2]->load(std::memory_order_relaxed);
+    snapshot.offsetR4 = mBandOffsetRParams[2]->load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+float TableTennisAudioProcessor::getDelayTimeMs(const ParameterSnapshot& snapshot) const noexcept
+{
+    /*
+        When the delay is synced, its length comes from the host's tempo.
+        Without a play head or a tempo it stays on the free running time.
+    */
+
+    auto bpm = mHostBpm.load(std::memory_order_relaxed);
+
+    if (snapshot.tempoSync > 0 && bpm > 0.0)
+        return (float) juce::jmin((double) maxDelayTimeMs, noteDivisionBeats[snapshot.tempoSync] * 60000.0 / bpm);
+
+    return snapshot.delayTime;
+}
+
+PingPongEngine::Settings TableTennisAudioProcessor::makeEngineSettings(const ParameterSnapshot& snapshot) const noexcept
+{
+    PingPongEngine::Settings settings;
+
+    settings.delayTimeMs = getDelayTimeMs(snapshot);
+    settings.offsetLMs = snapshot.offsetL;
+    settings.offsetRMs = snapshot.offsetR;
+    settings.feedback = snapshot.feedback;
+    settings.mix = snapshot.mix;
+    settings.gain = snapshot.gain;
+    settings.mode = static_cast<PingPongEngine::Mode>(snapshot.effectsMode);
+    settings.interpolation = static_cast<DelayInterpolation::Type>(snapshot.interpolation);
+    settings.useFeedbackMatrix = snapshot.feedbackRouting == 1;
+    settings.feedbackRotation = snapshot.feedbackRotation;
+    settings.tapCount = snapshot.tapCount;
+    settings.tapDecay = snapshot.tapDecay;
+    settings.tapSpread = snapshot.tapSpread;
+    settings.lowCutHz = snapshot.lowCut;
+    settings.highCutHz = snapshot.highCut;
+    settings.tiltDb = snapshot.tilt;
+    settings.modRateHz = snapshot.modRate;
+    settings.modDepthMs = snapshot.modDepth;
+    settings.modPhaseDegrees = snapshot.modPhase;
+    settings.modDrift = snapshot.modDrift;
+    settings.diffusion = snapshot.diffusion;
+
+    // The loop time takes over from the delay time (and the tempo sync) once the lines are long enough for it
+    if (snapshot.longDelay && mEngine.isUsingScratchFile())
+        settings.delayTimeMs = snapshot.loopTime * 1000.f;
+
+    // The tempo sync only sets the first band; the others keep their own times
+    settings.numBands = snapshot.bands;
+    settings.crossoverHz = { snapshot.crossover1, snapshot.crossover2, snapshot.crossover3 };
+    settings.upperBands = { PingPongEngine::Band{ snapshot.delayTime2, snapshot.offsetL2, snapshot.offsetR2, snapshot.feedback2 },
+                            PingPongEngine::Band{ snapshot.delayTime3, snapshot.offsetL3, snapshot.offsetR3, snapshot.feedback3 },
+                            PingPongEngine::Band{ snapshot.delayTime4, snapshot.offsetL4, snapshot.offsetR4, snapshot.feedback4 } };
+
+    return settings;
+}
+
+double TableTennisAudioProcessor::getTailLengthSeconds(const ParameterSnapshot& snapshot) const noexcept
+{
+    return PingPongEngine::getTailLengthSeconds(makeEngineSettings(snapshot));
+}
+
+void TableTennisAudioProcessor::updateHostTempo() noexcept
+{
+    auto hostBpm = 0.0;
+
+    if (auto* playHead = getPlayHead())
+        if (auto position = playHead->getPosition())
+            if (auto bpm = position->getBpm())
+                hostBpm = *bpm;
+
+    mHostBpm.store(hostBpm, std::memory_order_relaxed);
+}
+
+void TableTennisAudioProcessor::releaseResources()
+{
+    // When playback stops, you can use this as an opportunity to free up any
+    // spare memory, etc.
+
+    mEngine.release();
+    mPreparedBlockSize = 0;
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool TableTennisAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // This is the place where you check if the layout is supported.
+    // Anything from mono up to the kernel's channel count works, surround
+    // and ambisonic layouts included, as every channel gets its own line.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numChannels < 1 || numChannels > PingPongKernelBase::maxChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void TableTennisAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, mBypassParam->load(std::memory_order_relaxed) >= 0.5f);
+}
+
+void TableTennisAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // A 64 bit host gets the double kernel, so its buffers are never converted to float
+    process(buffer, mBypassParam->load(std::memory_order_relaxed) >= 0.5f);
+}
+
+void TableTennisAudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // Hosts that bypass without going through getBypassParameter get the same fade out
+    process(buffer, true);
+}
+
+void TableTennisAudioProcessor::processBlockBypassed(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, true);
+}
+
+juce::AudioProcessorParameter* TableTennisAudioProcessor::getBypassParameter() const
+{
+    return treeState.getParameter("audioBypass");
+}
+
+template <typename SampleType>
+void TableTennisAudioProcessor::process(juce::AudioBuffer<SampleType>& buffer, bool bypassed)
+{
+    juce::ScopedNoDenormals noDenormals;
+    Telemetry::ScopedBlock<SampleType> telemetryBlock(mTelemetry, buffer);
+
+    auto totalNumInputChannels = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+    // In case we have more outputs than inputs, this code clears any output
+    // channels that didn't contain input data, (because these aren't
+    // guaranteed to be empty - they may contain garbage).
+
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear(i, 0, buffer.getNumSamples());
+
+    auto& bypassBuffer = std::get<juce::AudioBuffer<SampleType>>(mBypassBuffers);
+
+    auto numChannels = mNumChannels;
+    auto numSamples = buffer.getNumSamples();
+
+    // The engine has a line for every channel of the bus it was prepared with,
+    // and none at all if prepareToPlay was called for the other precision
+    if (! mEngine.isPreparedFor<SampleType>() || buffer.getNumChannels() < numChannels)
+    {
+        jassertfalse;
+        return;
+    }
+
+    /*
+        Bypass Control - passes the input straight through.
+
+        Once the fade has finished the buffer is left exactly as the host
+        gave it, with no work done at all. The delay line is flushed the first
+        time round, so switching back on starts from silence rather than
+        replaying whatever was left in it.
+    */
+
+    mBypassFade.setTargetValue(bypassed ? 0.f : 1.f);
+
+    if (bypassed && mBypassFade.isSettled())
+    {
+        if (! mBypassFlushed)
+        {
+            mEngine.reset();
+            mBypassFlushed = true;
+        }
+
+        return;
+    }
+
+    mBypassFlushed = false;
+
+    /*
+        While the bypass is switching, the untouched input is kept aside and
+        the output fades between it and the effect, which stops the click.
+        A block bigger than prepareToPlay promised just switches straight over.
+    */
+
+    auto isFading = ! mBypassFade.isSettled() && numSamples <= bypassBuffer.getNumSamples();
+    auto fade = mBypassFade.getNextBlock(numSamples);
+
+    if (isFading)
+        for (int channel = 0; channel < numChannels; ++channel)
+            bypassBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+    processEffect(buffer);
+    publishVisualiserFrame(numSamples);
+
+    if (isFading)
+    {
+        auto* gains = bypassBuffer.getWritePointer(numChannels);
+        BlockRamp::fill(gains, fade.start, (fade.end - fade.start) / (float) numSamples, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            // output = dry + fade * (wet - dry)
+            auto* wet = buffer.getWritePointer(channel);
+            auto* dry = bypassBuffer.getReadPointer(channel);
+
+            juce::FloatVectorOperations::subtract(wet, dry, numSamples);
+            juce::FloatVectorOperations::multiply(wet, gains, numSamples);
+            juce::FloatVectorOperations::add(wet, dry, numSamples);
+        }
+    }
+}
+
+template <typename SampleType>
+void TableTennisAudioProcessor::processEffect(juce::AudioBuffer<SampleType>& buffer) noexcept
+{
+    /*
+        The parameters are read once per block and handed to the engine,
+        which takes them up at its next control tick. Everything else,
+        the ramps, the modulation, sleeping through silence and the
+        ping-pong itself, happens inside PingPongEngine.
+    */
+
+    auto numSamples = buffer.getNumSamples();
+
+    // A program change takes effect from the start of this block, not the next control tick
+    auto programOverride = mProgramOverride.load(std::memory_order_acquire);
+
+    if (programOverride != mLastProgramOverride)
+    {
+        mLastProgramOverride = programOverride;
+        mEngine.restartControlTick();
+    }
+
+    updateHostTempo();
+
+    auto settings = makeEngineSettings(getParameterSnapshot());
+
+    if (settings.useFeedbackMatrix)
+        settings.feedbackMatrix = getFeedbackMatrix(mNumChannels);
+
+    mEngine.setSettings(settings);
+
+    PingPongEngine::Meters meters;
+    meters.loopEnergy = mTelemetry.getLoopEnergyMeter();
+
+    // The input peaks for the editor, taken before the engine overwrites the input
+    if (mVisualiserActive.load(std::memory_order_relaxed))
+    {
+        for (int channel = 0; channel < mNumChannels; ++channel)
+            mVisualiserFrame.inputPeaks[(size_t) channel] = juce::jmax(mVisualiserFrame.inputPeaks[(size_t) channel],
+                                                                       (float) buffer.getMagnitude(channel, 0, numSamples));
+
+        meters.wetPeaks = mVisualiserFrame.wetPeaks.data();
+    }
+
+    mEngine.process(buffer.getArrayOfWritePointers(), numSamples, meters);
+}
+
+void TableTennisAudioProcessor::publishVisualiserFrame(int numSamples) noexcept
+{
+    /*
+        Fills in the echo pattern the lines are heading for and pushes the
+        frame. The peaks start again from silence after every push; if the
+        FIFO is full the frame is dropped and they carry on into the next one.
+    */
+
+    if (! mVisualiserActive.load(std::memory_order_relaxed))
+        return;
+
+    mVisualiserCountdown -= numSamples;
+
+    if (mVisualiserCountdown > 0)
+        return;
+
+    mVisualiserCountdown = juce::jmax(1, (int) (mSampleRate / visualiserFrameRateHz));
+
+    auto& settings = mEngine.getControlSettings();
+    auto& taps = mEngine.getTapPattern();
+    auto& frame = mVisualiserFrame;
+    auto samplesToMs = (float) (1000.0 / mSampleRate);
+
+    frame.numLines = mNumChannels;
+
+    for (int line = 0; line < mNumChannels; ++line)
+        frame.delaysMs[(size_t) line] = mEngine.getCurrentDelayInSamples(line) * samplesToMs;
+
+    frame.feedback = mEngine.getCurrentFeedback();
+    frame.mode = (int) settings.mode;
+    frame.rotation = settings.useFeedbackMatrix ? 0 : settings.feedbackRotation;
+    frame.numTaps = settings.mode == PingPongEngine::Mode::multiTap ? taps.numTaps : 0;
+
+    for (int i = 0; i < frame.numTaps; ++i)
+    {
+        auto& tap = taps.taps[(size_t) i];
+
+        frame.tapScales[(size_t) i] = tap.delayScale;
+        frame.tapGains[(size_t) i] = tap.gainToSame + tap.gainToNext;
+    }
+
+    if (mVisualiserFifo.push(frame))
+    {
+        frame.inputPeaks.fill(0.f);
+        frame.wetPeaks.fill(0.f);
+    }
+}
+
+//==============================================================================
+bool TableTennisAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* TableTennisAudioProcessor::createEditor()
+{
+    return new TableTennisAudioProcessorEditor (*this, treeState);
+}
+
+//==============================================================================
+void TableTennisAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    // A flat, versioned list of the parameter values, then the user programs; see BinaryState
+    mBinaryState.save(destData, writeUserPrograms());
+
+    // Gets the values from the last session and uses them in the current one
+}
+
+void TableTennisAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // Whatever the state says wins over a program change that hasn't reached the parameters yet
+    mProgramOverride.store(noProgram);
+
+    juce::MemoryBlock programs;
+
+    if (mBinaryState.load(data, sizeInBytes, &programs))
+    {
+        readUserPrograms(programs);
+        return;
+    }
+
+    // Projects saved before the binary format still hold the XML state
+    if (BinaryState::isBinaryState(data, sizeInBytes))
+        return; // Written by a newer layout than this build can read
+
+    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+
+    if (xmlState.get() != nullptr)
+    {
+        if (xmlState->hasTagName(treeState.state.getType()))
+        {
+            convertLegacyDelayUnits(*xmlState, mSampleRate);
+            treeState.replaceState(juce::ValueTree::fromXml(*xmlState));
+        }
+    }
+
+    // Saves values from the users input and stores them till the next session
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new TableTennisAudioProcessor();
+}
@@ -1,93 +1,335 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-//==============================================================================
-/**
-*/
-class TableTennisAudioProcessor  : public juce::AudioProcessor, 
-                                   public juce::AudioProcessorValueTreeState::Listener 
-{
-public:
-    //==============================================================================
-    TableTennisAudioProcessor();
-    ~TableTennisAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-
-    void parameterChanged(const juce::String& parameterID, float newValue) override;
-
-private:
-
-    juce::AudioProcessorValueTreeState treeState;
-
-    /*
-    The code below does not accomodate a changing of sample rate
-
-        It currently supports 3 seconds of audio at 192kHz, but does not support
-     variable audio just yet. This will be implemented further down the line.
-
-    */
-
-    juce::dsp::DelayLine<float> mDelayLine{ 576000 };
-
-    /*
-    The variables below will hold a copy of values from the controls
-    They will be updated any time the controls - from the UI, are adjusted.
-
-    This is broken up into the different storage options.
-    */
-
-    float mDelayTime = 1000.0f;
-    float mFeedback = 0.3f;
-    float mVolume = 0.f;
-    float mOffsetL = 0.f;
-    float mOffsetR = 0.f;
-    float mMix = 0.f;
-    
-    bool  mBypass;
-
-    int mEffectChoice = 0;
-
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TableTennisAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PingPongEngine.h"
+#include "VisualiserFifo.h"
+#include "Telemetry.h"
+#include "BinaryState.h"
+#include "ProgramBank.h"
+
+//==============================================================================
+/**
+*/
+class TableTennisAudioProcessor  : public juce::AudioProcessor,
+                                   private juce::Timer
+{
+public:
+    //==============================================================================
+    TableTennisAudioProcessor();
+    ~TableTennisAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    juce::AudioProcessorParameter* getBypassParameter() const override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    /*
+        Adds the current settings to the bank as a user program and makes it
+        the current one. Returns its index, or -1 if the bank is full. The
+        user programs are saved with the rest of the state.
+    */
+    int saveProgram(const juce::String& name);
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    //==============================================================================
+    /*
+        Sets how long the delay buffer can be, in milliseconds. The buffer is sized
+        from this and the sample rate in prepareToPlay, so call this before it.
+
+        Anything above the delay time and offset parameter ranges is never used.
+    */
+    void setMaximumDelayTime(float milliseconds) { mEngine.setMaximumDelayTime(milliseconds); }
+    float getMaximumDelayTime() const noexcept { return mEngine.getMaximumDelayTime(); }
+
+    /*
+        Parameters are read at the start of each block and handed to the
+        engine, which steps its ramps every controlBlockSize samples, counted
+        from prepareToPlay rather than from the start of each block, so
+        automation follows the same path whatever the host's buffer size is.
+    */
+    static constexpr int controlBlockSize = PingPongEngine::controlBlockSize;
+
+    // Parameter ranges, in milliseconds
+    static constexpr float maxDelayTimeMs = PingPongEngine::maxDelayTimeMs;
+    static constexpr float maxOffsetMs = PingPongEngine::maxOffsetMs;
+    static constexpr float maxModDepthMs = PingPongEngine::maxModDepthMs;
+
+    // The "loopTime" range, in seconds, for the long delay mode
+    static constexpr float maxLoopTimeSeconds = PingPongEngine::maxLongDelayTimeMs / 1000.f;
+
+    /*
+        Sets the mixing matrix used when "feedbackRouting" is on "Matrix". It is
+        numChannels by numChannels, row major, one row per destination channel.
+
+        It only takes effect while the bus has that many channels; otherwise, or
+        until this is called, the lines are mixed by a Householder reflection,
+        which spreads every line evenly into all the others without growing.
+    */
+    void setFeedbackMatrix(const float* matrix, int numChannels);
+
+    /*
+        The editor's live view. While an editor is listening, the audio thread
+        gathers the input and wet peaks and pushes a VisualiserFrame about
+        visualiserFrameRateHz times a second into the FIFO, for the editor to
+        pop on its timer. With no editor open nothing is measured at all.
+    */
+    static constexpr double visualiserFrameRateHz = 60.0;
+
+    VisualiserFifo& getVisualiserFifo() noexcept { return mVisualiserFifo; }
+    void setVisualiserActive(bool shouldBeActive) noexcept { mVisualiserActive.store(shouldBeActive, std::memory_order_relaxed); }
+
+    /*
+        What this instance costs; block times, CPU load and levels, published
+        every half second. It can be read from any thread, and compiles out
+        when TABLETENNIS_TELEMETRY is 0.
+    */
+    const Telemetry& getTelemetry() const noexcept { return mTelemetry; }
+
+private:
+
+    juce::AudioProcessorValueTreeState treeState;
+
+    // The saved state; made after treeState, once every parameter exists
+    BinaryState mBinaryState{ *this };
+
+    /*
+    The delay itself; everything that happens to the audio, apart from the
+    bypass fade. It knows nothing about JUCE, and is prepared for whichever
+    precision the host processes with.
+    */
+
+    PingPongEngine mEngine;
+
+    double mSampleRate = 44100.0;
+    int mNumChannels = 1;
+    int mPreparedBlockSize = 0;         // 0 until prepareToPlay, and after releaseResources
+
+    void updateEngineLayout();
+    int getBandsParameter() const noexcept;
+
+    /*
+    The handles below point straight at the values held by treeState, so the
+    audio thread can read them without any string look ups or locks.
+
+    They are copied into a ParameterSnapshot once at the start of each block,
+    so the whole block sees one consistent set of values.
+    */
+
+    std::atomic<float>* mDelayTimeParam = nullptr;
+    std::atomic<float>* mFeedbackParam = nullptr;
+    std::atomic<float>* mGainParam = nullptr;
+    std::atomic<float>* mOffsetLParam = nullptr;
+    std::atomic<float>* mOffsetRParam = nullptr;
+    std::atomic<float>* mMixParam = nullptr;
+    std::atomic<float>* mBypassParam = nullptr;
+    std::atomic<float>* mTempoSyncParam = nullptr;
+    std::atomic<float>* mEffectsModeParam = nullptr;
+    std::atomic<float>* mTapCountParam = nullptr;
+    std::atomic<float>* mTapDecayParam = nullptr;
+    std::atomic<float>* mTapSpreadParam = nullptr;
+    std::atomic<float>* mInterpolationParam = nullptr;
+    std::atomic<float>* mFeedbackRoutingParam = nullptr;
+    std::atomic<float>* mFeedbackRotationParam = nullptr;
+    std::atomic<float>* mLowCutParam = nullptr;
+    std::atomic<float>* mHighCutParam = nullptr;
+    std::atomic<float>* mTiltParam = nullptr;
+    std::atomic<float>* mModRateParam = nullptr;
+    std::atomic<float>* mModDepthParam = nullptr;
+    std::atomic<float>* mModPhaseParam = nullptr;
+    std::atomic<float>* mModDriftParam = nullptr;
+    std::atomic<float>* mDiffusionParam = nullptr;
+    std::atomic<float>* mLongDelayParam = nullptr;
+    std::atomic<float>* mLoopTimeParam = nullptr;
+    std::atomic<float>* mMorphParam = nullptr;
+    std::atomic<float>* mMorphTargetParam = nullptr;
+    std::atomic<float>* mBandsParam = nullptr;
+
+    // Multiband; crossovers 1 to 3, and bands 2 to 4 (the first band is the delay time, feedback and offsets above)
+    std::array<std::atomic<float>*, PingPongEngine::maxBands - 1> mCrossoverParams{};
+    std::array<std::atomic<float>*, PingPongEngine::maxBands - 1> mBandDelayTimeParams{};
+    std::array<std::atomic<float>*, PingPongEngine::maxBands - 1> mBandFeedbackParams{};
+    std::array<std::atomic<float>*, PingPongEngine::maxBands - 1> mBandOffsetLParams{};
+    std::array<std::atomic<float>*, PingPongEngine::maxBands - 1> mBandOffsetRParams{};
+
+    struct ParameterSnapshot
+    {
+        float delayTime = 250.f;    // milliseconds, as are the offsets
+        float feedback = 0.3f;
+        float gain = 0.f;
+        float offsetL = 0.f;
+        float offsetR = 0.f;
+        float mix = 0.f;
+        bool  bypass = false;
+        int   tempoSync = 0;
+        int   effectsMode = 0;
+        int   tapCount = 4;
+        float tapDecay = 0.7f;
+        float tapSpread = 1.f;
+        int   interpolation = 1;
+        int   feedbackRouting = 0;
+        int   feedbackRotation = 1;
+        float lowCut = FeedbackFilter::lowCutOffHz;
+        float highCut = FeedbackFilter::highCutOffHz;
+        float tilt = 0.f;
+        float modRate = 0.5f;       // Hz
+        float modDepth = 0.f;       // milliseconds
+        float modPhase = 90.f;      // degrees
+        float modDrift = 0.f;
+        float diffusion = 0.f;      // 0 is clean repeats
+        bool  longDelay = false;
+        float loopTime = 30.f;      // seconds, in the long delay mode
+        float morph = 0.f;          // 0 is these settings, 1 is the morph target program
+        int   morphTarget = 1;      // Program number, from 1
+        int   bands = 1;
+        float crossover1 = 250.f;   // Hz, low to high
+        float crossover2 = 1500.f;
+        float crossover3 = 6000.f;
+        float delayTime2 = 250.f, feedback2 = 0.3f, offsetL2 = 0.f, offsetR2 = 0.f;
+        float delayTime3 = 250.f, feedback3 = 0.3f, offsetL3 = 0.f, offsetR3 = 0.f;
+        float delayTime4 = 250.f, feedback4 = 0.3f, offsetL4 = 0.f, offsetR4 = 0.f;
+
+        auto tie() const noexcept
+        {
+            return std::tie(delayTime, feedback, gain, offsetL, offsetR, mix, bypass, tempoSync, effectsMode,
+                            tapCount, tapDecay, tapSpread, interpolation, feedbackRouting, feedbackRotation,
+                            lowCut, highCut, tilt, modRate, modDepth, modPhase, modDrift, diffusion, longDelay, loopTime, morph, morphTarget,
+                            bands, crossover1, crossover2, crossover3, delayTime2, feedback2, offsetL2, offsetR2,
+                            delayTime3, feedback3, offsetL3, offsetR3, delayTime4, feedback4, offsetL4, offsetR4);
+        }
+
+        bool operator==(const ParameterSnapshot& other) const noexcept { return tie() == other.tie(); }
+        bool operator!=(const ParameterSnapshot& other) const noexcept { return tie() != other.tie(); }
+    };
+
+    ParameterSnapshot getParameterSnapshot() const noexcept;
+    ParameterSnapshot readParameterValues() const noexcept;
+    float getDelayTimeMs(const ParameterSnapshot& snapshot) const noexcept;
+
+    /*
+    What the engine is asked for; the snapshot in the engine's own terms,
+    with the tempo sync worked out. The host's tempo is read once per block.
+    */
+
+    std::atomic<double> mHostBpm { 0.0 };   // Also read by getTailLengthSeconds on the message thread
+
+    PingPongEngine::Settings makeEngineSettings(const ParameterSnapshot& snapshot) const noexcept;
+    void updateHostTempo() noexcept;
+
+    double getTailLengthSeconds(const ParameterSnapshot& snapshot) const noexcept;
+
+    /*
+    Bypass. mBypassFade goes from 1 (effect) to 0 (dry) over a short fade,
+    and mBypassBuffers keep the dry input while it does.
+    */
+
+    ParameterRamp mBypassFade;
+    std::tuple<juce::AudioBuffer<float>, juce::AudioBuffer<double>> mBypassBuffers;
+    bool mBypassFlushed = false;
+
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, bool bypassed);
+
+    template <typename SampleType>
+    void processEffect(juce::AudioBuffer<SampleType>& buffer) noexcept;
+
+    /*
+    Programs. setCurrentProgram only sets mProgramOverride to the program's
+    index, so it is safe from any thread, and the audio thread copies its
+    values out of the bank from its next block. The timer then copies them
+    into the parameters on the message thread, for the editor and the host,
+    and clears the override. The morph blends whatever the parameters say
+    towards the morph target program, inside getParameterSnapshot.
+    */
+
+    ProgramBank<ParameterSnapshot> mPrograms;
+    std::atomic<int> mCurrentProgram{ 0 };
+    static constexpr int noProgram = -1;
+    std::atomic<int> mProgramOverride{ noProgram };
+    int mLastProgramOverride = noProgram;   // Audio thread
+
+    template <typename Function>
+    static void forEachProgramField(Function&& function);
+
+    static ParameterSnapshot morphSnapshots(const ParameterSnapshot& from, const ParameterSnapshot& to, float amount) noexcept;
+    ParameterSnapshot getDefaultSnapshot() const;
+    void addFactoryPrograms();
+    juce::MemoryBlock writeUserPrograms() const;
+    void readUserPrograms(const juce::MemoryBlock& data);
+    void timerCallback() override;
+
+    // The live view; mVisualiserFrame gathers the peaks until the next push
+    VisualiserFifo mVisualiserFifo;
+    std::atomic<bool> mVisualiserActive { false };
+    VisualiserFrame mVisualiserFrame;
+    int mVisualiserCountdown = 0;
+
+    void publishVisualiserFrame(int numSamples) noexcept;
+
+    // Telemetry, and the optional thread that dumps it (it reads mTelemetry, so comes after it)
+    Telemetry mTelemetry;
+    std::unique_ptr<TelemetryDumper> mTelemetryDumper;
+
+    /*
+    The feedback matrix. The message thread writes mPendingMatrix under the
+    lock, and the audio thread only copies it across when it can take the
+    lock without waiting, so it never blocks.
+    */
+
+    using FeedbackMatrix = std::array<float, PingPongKernelBase::maxChannels * PingPongKernelBase::maxChannels>;
+
+    juce::SpinLock mMatrixLock;
+    FeedbackMatrix mPendingMatrix{};
+    int  mPendingMatrixSize = 0;
+    bool mMatrixChanged = false;
+
+    FeedbackMatrix mFeedbackMatrix{};
+    int mFeedbackMatrixSize = 0;
+
+    // The matrix set for this many channels, or nullptr for the engine's Householder one
+    const float* getFeedbackMatrix(int numChannels) noexcept;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TableTennisAudioProcessor)
+};
@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    ProgramBank.h
+
+    Pre-allocated bank of programs that the audio thread can read.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A fixed number of program slots, each holding a name and a full set of
+    parameter values (a Values, the processor's parameter snapshot).
+
+    All the memory is in the bank itself, so nothing is allocated once it
+    exists. Only the values are for the audio thread; the names belong to
+    the message thread.
+
+    Every slot keeps two copies of its values and a version number, and the
+    copy at (version & 1) is the current one. Writing a slot fills the other
+    copy and then bumps the version. readValues() copies the current values
+    out and checks that the version didn't move meanwhile; if it did, the copy
+    it read may have been written over, so it reads the new current one
+    instead. A reader never waits for a writer to finish, and only goes round
+    again when a whole write lands during its copy, so the audio thread can
+    use it. The audio thread never keeps a pointer into the bank, only a
+    program's index.
+
+    The first programs added are the factory ones, and lockFactoryPrograms()
+    stops them from being overwritten. The user's programs follow them.
+*/
+template <typename Values>
+class ProgramBank
+{
+public:
+    static constexpr int maxPrograms = 32;
+
+    static_assert (std::is_trivially_copyable<Values>::value, "The values are copied while they may be being written");
+
+    //==============================================================================
+    /** Message thread. Adds a program at the end; returns its index, or -1 when the bank is full. */
+    int addProgram (const juce::String& name, const Values& values)
+    {
+        const juce::SpinLock::ScopedLockType lock (mWriteLock);
+
+        auto index = mNumPrograms.load();
+
+        if (index >= maxPrograms)
+            return -1;
+
+        writeProgram (index, name, values);
+        mNumPrograms.store (index + 1, std::memory_order_release);
+        return index;
+    }
+
+    /** Message thread. Replaces a user program; the factory ones are left alone. */
+    bool setProgram (int index, const juce::String& name, const Values& values)
+    {
+        const juce::SpinLock::ScopedLockType lock (mWriteLock);
+
+        if (! isUserProgram (index))
+            return false;
+
+        writeProgram (index, name, values);
+        return true;
+    }
+
+    /** Message thread. Renames a user program. */
+    bool setName (int index, const juce::String& name)
+    {
+        const juce::SpinLock::ScopedLockType lock (mWriteLock);
+
+        if (! isUserProgram (index))
+            return false;
+
+        auto& slot = mSlots[(size_t) index];
+        writeProgram (index, name, slot.copies[slot.version.load() & 1]);
+        return true;
+    }
+
+    /**
+        Message thread. Replaces every user program with programs[0] to
+        programs[numPrograms - 1], each something with a name and values,
+        keeping the factory ones. The slots are written over one by one,
+        like setProgram() does, so the audio thread keeps reading whole
+        programs throughout. Returns how many fitted in.
+    */
+    template <typename ProgramType>
+    int setUserPrograms (const ProgramType* programs, int numPrograms)
+    {
+        const juce::SpinLock::ScopedLockType lock (mWriteLock);
+
+        numPrograms = juce::jmin (numPrograms, maxPrograms - mNumFactoryPrograms);
+
+        for (int i = 0; i < numPrograms; ++i)
+            writeProgram (mNumFactoryPrograms + i, programs[i].name, programs[i].values);
+
+        mNumPrograms.store (mNumFactoryPrograms + numPrograms, std::memory_order_release);
+        return numPrograms;
+    }
+
+    void lockFactoryPrograms() noexcept                 { mNumFactoryPrograms = mNumPrograms.load(); }
+    int getNumFactoryPrograms() const noexcept          { return mNumFactoryPrograms; }
+
+    //==============================================================================
+    /** Any thread. */
+    int getNumPrograms() const noexcept                 { return mNumPrograms.load (std::memory_order_acquire); }
+
+    /** Message thread. An empty string if there is no such program. */
+    juce::String getName (int index) const
+    {
+        const juce::SpinLock::ScopedLockType lock (mWriteLock);
+
+        if (! juce::isPositiveAndBelow (index, getNumPrograms()))
+            return {};
+
+        return mSlots[(size_t) index].name;
+    }
+
+    /** Any thread, the audio thread included. Copies a program's values into dest; false if there is no such program. */
+    bool readValues (int index, Values& dest) const noexcept
+    {
+        if (! juce::isPositiveAndBelow (index, getNumPrograms()))
+            return false;
+
+        auto& slot = mSlots[(size_t) index];
+
+        for (;;)
+        {
+            auto version = slot.version.load (std::memory_order_acquire);
+            dest = slot.copies[version & 1];
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (slot.version.load (std::memory_order_relaxed) == version)
+                return true;
+        }
+    }
+
+private:
+    struct Slot
+    {
+        juce::String name;
+        std::array<Values, 2> copies;
+        std::atomic<juce::uint32> version { 0 };
+    };
+
+    bool isUserProgram (int index) const noexcept
+    {
+        return juce::isPositiveAndBelow (index, getNumPrograms()) && index >= mNumFactoryPrograms;
+    }
+
+    // Called with mWriteLock held
+    void writeProgram (int index, const juce::String& name, const Values& values)
+    {
+        auto& slot = mSlots[(size_t) index];
+        auto version = slot.version.load (std::memory_order_relaxed);
+
+        // Keeps the copy from being written before the last version bump is seen, by a reader still on it
+        std::atomic_thread_fence (std::memory_order_release);
+
+        slot.copies[(version + 1) & 1] = values;
+        slot.name = name;
+
+        slot.version.store (version + 1, std::memory_order_release);
+    }
+
+    std::array<Slot, maxPrograms> mSlots;
+    std::atomic<int> mNumPrograms { 0 };
+    int mNumFactoryPrograms = 0;
+
+    // Writers may come from the message thread or a host's own thread (a state load); never taken by readValues()
+    mutable juce::SpinLock mWriteLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgramBank)
+};
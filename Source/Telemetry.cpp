@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    Telemetry.cpp
+
+    What one instance of the processor costs, measured on the audio thread.
+
+  ==============================================================================
+*/
+
+#include "Telemetry.h"
+
+#if TABLETENNIS_TELEMETRY && JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+#if TABLETENNIS_TELEMETRY && (JUCE_LINUX || JUCE_MAC || JUCE_BSD)
+ #include <sys/socket.h>
+ #include <sys/un.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #define TABLETENNIS_UNIX_SOCKETS 1
+#else
+ #define TABLETENNIS_UNIX_SOCKETS 0
+#endif
+
+namespace
+{
+    float toDecibels (double level) noexcept
+    {
+        return juce::Decibels::gainToDecibels ((float) level, -100.f);
+    }
+}
+
+//==============================================================================
+juce::var TelemetrySnapshot::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+
+    object->setProperty ("sampleRate", sampleRate);
+    object->setProperty ("numChannels", numChannels);
+    object->setProperty ("numBlocks", numBlocks);
+    object->setProperty ("blocksOverBudget", blocksOverBudget);
+    object->setProperty ("meanMicros", meanMicros);
+    object->setProperty ("p99Micros", p99Micros);
+    object->setProperty ("maxMicros", maxMicros);
+    object->setProperty ("cyclesPerSample", cyclesPerSample);
+    object->setProperty ("cpuLoad", cpuLoad);
+    object->setProperty ("peakDb", peakDb);
+    object->setProperty ("rmsDb", rmsDb);
+    object->setProperty ("loopEnergyDb", loopEnergyDb);
+    object->setProperty ("totalBlocks", totalBlocks);
+    object->setProperty ("totalBlocksOverBudget", totalBlocksOverBudget);
+
+    return juce::var (object);
+}
+
+#if TABLETENNIS_TELEMETRY
+//==============================================================================
+void Telemetry::prepare (double sampleRate, int numChannels) noexcept
+{
+    mSampleRate = sampleRate;
+    mNumChannels = numChannels;
+    mWindowLength = juce::jmax (1, (int) (sampleRate * windowSeconds));
+    mBlockCounter = 0;
+    mMeasureLevels = false;
+    mTotalBlocks = mTotalOverBudget = 0;
+
+    mHistogram.fill (0);
+    mWindowSamples = mWindowBlocks = mWindowOverBudget = 0;
+    mWindowMicros = mWindowMaxMicros = 0.0;
+    mWindowCycles = 0;
+    mWindowPeak = 0.f;
+    mWindowSumOfSquares = 0.0;
+    mWindowLevelSamples = 0;
+    mLoopEnergy = {};
+
+    publish();
+}
+
+bool Telemetry::read (TelemetrySnapshot& snapshot) const noexcept
+{
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        auto before = mSequence.load (std::memory_order_acquire);
+
+        if ((before & 1) != 0)
+        {
+            juce::Thread::yield();
+            continue;
+        }
+
+        snapshot = mPublished;
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        if (mSequence.load (std::memory_order_relaxed) == before)
+            return true;
+    }
+
+    return false;
+}
+
+//==============================================================================
+int Telemetry::getBucket (double micros) noexcept
+{
+    if (micros <= 1.0)
+        return 0;
+
+    return juce::jlimit (0, numBuckets - 1, (int) (std::log2 (micros) * bucketsPerOctave));
+}
+
+double Telemetry::getBucketMicros (int bucket) noexcept
+{
+    return std::exp2 ((double) bucket / (double) bucketsPerOctave);
+}
+
+juce::uint64 Telemetry::getCycleCount() noexcept
+{
+   #if JUCE_INTEL
+    return (juce::uint64) __rdtsc();
+   #else
+    return 0;
+   #endif
+}
+
+void Telemetry::beginBlock() noexcept
+{
+    mMeasureLevels = (mBlockCounter++ % levelSampleInterval) == 0;
+
+    mStartCycles = getCycleCount();
+    mStartTicks = juce::Time::getHighResolutionTicks();
+}
+
+void Telemetry::addBlock (int numSamples, double micros, juce::uint64 cycles) noexcept
+{
+    auto budgetMicros = (double) numSamples / mSampleRate * 1.0e6;
+
+    if (micros > budgetMicros)
+    {
+        ++mWindowOverBudget;
+        ++mTotalOverBudget;
+    }
+
+    ++mHistogram[(size_t) getBucket (micros)];
+    ++mWindowBlocks;
+    ++mTotalBlocks;
+
+    mWindowSamples += numSamples;
+    mWindowMicros += micros;
+    mWindowMaxMicros = juce::jmax (mWindowMaxMicros, micros);
+    mWindowCycles += cycles;
+
+    if (mWindowSamples >= mWindowLength)
+        publish();
+}
+
+void Telemetry::publish() noexcept
+{
+    /*
+        The p99 is the top of the histogram bucket that the 99th percentile
+        block falls in, so it is within a quarter octave of the true value,
+        and never more than the slowest block.
+    */
+
+    TelemetrySnapshot snapshot;
+
+    snapshot.sampleRate = mSampleRate;
+    snapshot.numChannels = mNumChannels;
+    snapshot.numBlocks = mWindowBlocks;
+    snapshot.blocksOverBudget = mWindowOverBudget;
+    snapshot.totalBlocks = mTotalBlocks;
+    snapshot.totalBlocksOverBudget = mTotalOverBudget;
+
+    if (mWindowBlocks > 0)
+    {
+        snapshot.meanMicros = mWindowMicros / (double) mWindowBlocks;
+        snapshot.maxMicros = mWindowMaxMicros;
+
+        auto rank = (int) std::ceil (0.99 * (double) mWindowBlocks);
+        auto count = 0;
+
+        for (int bucket = 0; bucket < numBuckets; ++bucket)
+        {
+            count += mHistogram[(size_t) bucket];
+
+            if (count >= rank)
+            {
+                snapshot.p99Micros = juce::jmin (mWindowMaxMicros, getBucketMicros (bucket + 1));
+                break;
+            }
+        }
+    }
+
+    if (mWindowSamples > 0)
+    {
+        snapshot.cyclesPerSample = (double) mWindowCycles / (double) mWindowSamples;
+        snapshot.cpuLoad = mWindowMicros * 1.0e-6 / ((double) mWindowSamples / mSampleRate);
+    }
+
+    snapshot.peakDb = toDecibels (mWindowPeak);
+
+    if (mWindowLevelSamples > 0)
+        snapshot.rmsDb = toDecibels (std::sqrt (mWindowSumOfSquares / (double) mWindowLevelSamples));
+
+    if (mLoopEnergy.numSamples > 0)
+        snapshot.loopEnergyDb = toDecibels (std::sqrt (mLoopEnergy.sumOfSquares / (double) mLoopEnergy.numSamples));
+
+    auto sequence = mSequence.load (std::memory_order_relaxed);
+    mSequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    mPublished = snapshot;
+
+    mSequence.store (sequence + 2, std::memory_order_release);
+
+    // Starts the next window
+    mHistogram.fill (0);
+    mWindowSamples = mWindowBlocks = mWindowOverBudget = 0;
+    mWindowMicros = mWindowMaxMicros = 0.0;
+    mWindowCycles = 0;
+    mWindowPeak = 0.f;
+    mWindowSumOfSquares = 0.0;
+    mWindowLevelSamples = 0;
+    mLoopEnergy = {};
+}
+#endif
+
+//==============================================================================
+std::unique_ptr<TelemetryDumper> TelemetryDumper::createFromEnvironment (const Telemetry& telemetry)
+{
+   #if TABLETENNIS_TELEMETRY
+    auto destination = juce::SystemStats::getEnvironmentVariable ("TABLETENNIS_TELEMETRY_DUMP", {});
+
+    if (destination.isEmpty())
+        return {};
+
+    auto intervalMs = juce::SystemStats::getEnvironmentVariable ("TABLETENNIS_TELEMETRY_INTERVAL_MS", "1000").getIntValue();
+
+    return std::make_unique<TelemetryDumper> (telemetry, destination, juce::jmax (50, intervalMs));
+   #else
+    juce::ignoreUnused (telemetry);
+    return {};
+   #endif
+}
+
+TelemetryDumper::TelemetryDumper (const Telemetry& telemetry, const juce::String& destination, int intervalMs)
+    : juce::Thread ("TableTennis telemetry"),
+      mTelemetry (telemetry), mDestination (destination), mIntervalMs (intervalMs),
+      mInstanceId (juce::Uuid().toDashedString())
+{
+    if (mDestination.startsWith ("file:"))
+    {
+        // A FileOutputStream on an existing file starts at its end, so every instance appends
+        mFile = std::make_unique<juce::FileOutputStream> (juce::File (mDestination.fromFirstOccurrenceOf ("file:", false, false)));
+
+        if (mFile->failedToOpen())
+            mFile.reset();
+    }
+   #if TABLETENNIS_UNIX_SOCKETS
+    else if (mDestination.startsWith ("unix:"))
+    {
+        mSocket = ::socket (AF_UNIX, SOCK_DGRAM, 0);
+
+        // The listener may be slow or gone; a full socket drops the line rather than stalling
+        if (mSocket >= 0)
+            ::fcntl (mSocket, F_SETFL, ::fcntl (mSocket, F_GETFL, 0) | O_NONBLOCK);
+    }
+   #endif
+
+    if (mFile != nullptr || mSocket >= 0)
+        startThread (juce::Thread::Priority::low);
+}
+
+TelemetryDumper::~TelemetryDumper()
+{
+    stopThread (2 * mIntervalMs);
+
+   #if TABLETENNIS_UNIX_SOCKETS
+    if (mSocket >= 0)
+        ::close (mSocket);
+   #endif
+}
+
+void TelemetryDumper::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (mIntervalMs);
+
+        TelemetrySnapshot snapshot;
+
+        if (threadShouldExit() || ! mTelemetry.read (snapshot))
+            continue;
+
+        auto object = snapshot.toVar();
+        object.getDynamicObject()->setProperty ("instance", mInstanceId);
+        object.getDynamicObject()->setProperty ("time", juce::Time::getCurrentTime().toISO8601 (true));
+
+        write (juce::JSON::toString (object, true));
+    }
+}
+
+void TelemetryDumper::write (const juce::String& line)
+{
+    if (mFile != nullptr)
+    {
+        mFile->writeText (line + "\n", false, false, nullptr);
+        mFile->flush();
+    }
+
+   #if TABLETENNIS_UNIX_SOCKETS
+    if (mSocket >= 0)
+    {
+        auto path = mDestination.fromFirstOccurrenceOf ("unix:", false, false);
+
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        path.copyToUTF8 (address.sun_path, sizeof (address.sun_path) - 1);
+
+        auto utf8 = line.toRawUTF8();
+        ::sendto (mSocket, utf8, std::strlen (utf8), 0, reinterpret_cast<const sockaddr*> (&address), sizeof (address));
+    }
+   #endif
+}
@@ -0,0 +1,236 @@
+/*
+  ==============================================================================
+
+    Telemetry.h
+
+    What one instance of the processor costs, measured on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PingPongKernel.h"
+
+/*
+    Set TABLETENNIS_TELEMETRY to 0 in the project's preprocessor definitions to
+    compile the telemetry out. Telemetry keeps the same interface either way,
+    with empty inline functions, so the calls to it vanish as well.
+*/
+#ifndef TABLETENNIS_TELEMETRY
+ #define TABLETENNIS_TELEMETRY 1
+#endif
+
+//==============================================================================
+/** One window's worth of figures, as published to the editor and the dumper. */
+struct TelemetrySnapshot
+{
+    double sampleRate = 0.0;
+    int numChannels = 0;
+
+    // Over the last window
+    int numBlocks = 0;
+    int blocksOverBudget = 0;       // Took longer than the audio they held lasts
+    double meanMicros = 0.0;        // processBlock time, per block
+    double p99Micros = 0.0;
+    double maxMicros = 0.0;
+    double cyclesPerSample = 0.0;   // CPU time stamp cycles, where there is a counter; 0 otherwise
+    double cpuLoad = 0.0;           // Processing time over audio time, 1 = all of one core
+
+    float peakDb = -100.f;          // Output levels
+    float rmsDb = -100.f;
+    float loopEnergyDb = -100.f;    // RMS of the signal going round the feedback loop
+
+    // Since prepareToPlay
+    juce::int64 totalBlocks = 0;
+    juce::int64 totalBlocksOverBudget = 0;
+
+    /** The figures as a JSON object. */
+    juce::var toVar() const;
+};
+
+//==============================================================================
+/**
+    Times every processBlock and keeps the levels, then publishes a
+    TelemetrySnapshot once per window of audio (windowSeconds).
+
+    The per-block cost is two clock reads, a histogram increment and a
+    vectorised peak search over the output. The block time p99 comes from a
+    log-spaced histogram, so no block times are stored or sorted. The RMS and
+    the feedback loop energy need a pass of their own, so they are only
+    measured on one block in every levelSampleInterval, which is plenty for
+    a level that is averaged over half a second anyway.
+
+    Publishing uses a sequence lock; the audio thread never waits, and a
+    reader that catches it mid-write just tries again.
+*/
+class Telemetry
+{
+public:
+    static constexpr double windowSeconds = 0.5;
+    static constexpr int levelSampleInterval = 8;
+
+   #if TABLETENNIS_TELEMETRY
+    //==============================================================================
+    /** Message thread, from prepareToPlay. */
+    void prepare (double sampleRate, int numChannels) noexcept;
+
+    /** Any thread. Returns false if the audio thread kept it busy for too long. */
+    bool read (TelemetrySnapshot& snapshot) const noexcept;
+
+    //==============================================================================
+    /** Times a block from construction to destruction, then takes its levels. */
+    template <typename SampleType>
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock (Telemetry& telemetry, const juce::AudioBuffer<SampleType>& buffer) noexcept
+            : mTelemetry (telemetry), mBuffer (buffer)
+        {
+            mTelemetry.beginBlock();
+        }
+
+        ~ScopedBlock()
+        {
+            mTelemetry.endBlock (mBuffer);
+        }
+
+    private:
+        Telemetry& mTelemetry;
+        const juce::AudioBuffer<SampleType>& mBuffer;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+    /** The kernel's loop energy meter, on the blocks that measure it. */
+    PingPongKernelBase::EnergyMeter* getLoopEnergyMeter() noexcept
+    {
+        return mMeasureLevels ? &mLoopEnergy : nullptr;
+    }
+
+private:
+    //==============================================================================
+    static constexpr int numBuckets = 96;      // Quarter octaves from 1us, to about 16s
+    static constexpr int bucketsPerOctave = 4;
+
+    static int getBucket (double micros) noexcept;
+    static double getBucketMicros (int bucket) noexcept;
+    static juce::uint64 getCycleCount() noexcept;
+
+    void beginBlock() noexcept;
+
+    template <typename SampleType>
+    void endBlock (const juce::AudioBuffer<SampleType>& buffer) noexcept;
+
+    void addBlock (int numSamples, double micros, juce::uint64 cycles) noexcept;
+    void publish() noexcept;
+
+    //==============================================================================
+    double mSampleRate = 44100.0;
+    int mNumChannels = 0;
+    int mWindowLength = 0;          // Samples
+    bool mMeasureLevels = false;
+    int mBlockCounter = 0;
+
+    juce::int64 mStartTicks = 0;
+    juce::uint64 mStartCycles = 0;
+
+    // The window being gathered
+    std::array<int, numBuckets> mHistogram {};
+    int mWindowSamples = 0;
+    int mWindowBlocks = 0;
+    int mWindowOverBudget = 0;
+    double mWindowMicros = 0.0;
+    double mWindowMaxMicros = 0.0;
+    juce::uint64 mWindowCycles = 0;
+    float mWindowPeak = 0.f;
+    double mWindowSumOfSquares = 0.0;
+    juce::int64 mWindowLevelSamples = 0;
+    PingPongKernelBase::EnergyMeter mLoopEnergy;
+
+    juce::int64 mTotalBlocks = 0;
+    juce::int64 mTotalOverBudget = 0;
+
+    // The last window, behind the sequence lock; odd while it is being written
+    std::atomic<juce::uint32> mSequence { 0 };
+    TelemetrySnapshot mPublished;
+
+   #else
+    //==============================================================================
+    // Compiled out; every call is empty and disappears
+    void prepare (double, int) noexcept {}
+    bool read (TelemetrySnapshot&) const noexcept   { return false; }
+
+    template <typename SampleType>
+    struct ScopedBlock
+    {
+        ScopedBlock (Telemetry&, const juce::AudioBuffer<SampleType>&) noexcept {}
+    };
+
+    PingPongKernelBase::EnergyMeter* getLoopEnergyMeter() noexcept  { return nullptr; }
+   #endif
+};
+
+#if TABLETENNIS_TELEMETRY
+template <typename SampleType>
+void Telemetry::endBlock (const juce::AudioBuffer<SampleType>& buffer) noexcept
+{
+    auto micros = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - mStartTicks) * 1.0e6;
+    auto cycles = getCycleCount() - mStartCycles;
+
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin (mNumChannels, buffer.getNumChannels());
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        mWindowPeak = juce::jmax (mWindowPeak, (float) buffer.getMagnitude (channel, 0, numSamples));
+
+    if (mMeasureLevels)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto rms = (double) buffer.getRMSLevel (channel, 0, numSamples);
+            mWindowSumOfSquares += rms * rms * (double) numSamples;
+        }
+
+        mWindowLevelSamples += (juce::int64) numSamples * numChannels;
+    }
+
+    addBlock (numSamples, micros, cycles);
+}
+#endif
+
+//==============================================================================
+/**
+    Writes a Telemetry snapshot as one line of JSON every interval, on its
+    own thread, to a local file (appended) or to a local UNIX datagram
+    socket. It is started from the TABLETENNIS_TELEMETRY_DUMP environment
+    variable, set to "file:<path>" or "unix:<path>", with the interval in
+    TABLETENNIS_TELEMETRY_INTERVAL_MS (1000 by default).
+
+    Nothing here runs on the audio thread; a socket with no listener, or a
+    file that can't be written, just loses the lines.
+*/
+class TelemetryDumper  : private juce::Thread
+{
+public:
+    /** Returns nullptr when the environment doesn't ask for a dump. */
+    static std::unique_ptr<TelemetryDumper> createFromEnvironment (const Telemetry& telemetry);
+
+    TelemetryDumper (const Telemetry& telemetry, const juce::String& destination, int intervalMs);
+    ~TelemetryDumper() override;
+
+private:
+    void run() override;
+    void write (const juce::String& line);
+
+    const Telemetry& mTelemetry;
+    juce::String mDestination;
+    int mIntervalMs;
+    juce::String mInstanceId;
+
+    std::unique_ptr<juce::FileOutputStream> mFile;
+    int mSocket = -1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TelemetryDumper)
+};
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    VisualiserFifo.h
+
+    Hands what the delay is doing from the audio thread to the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PingPongKernel.h"
+
+//==============================================================================
+/**
+    One picture of the delay; the levels since the last frame and the echo
+    pattern the lines are set to. It is plain data, so it can be copied in
+    and out of the FIFO without allocating.
+*/
+struct VisualiserFrame
+{
+    static constexpr int maxLines = PingPongKernelBase::maxChannels;
+    static constexpr int maxTaps = PingPongKernelBase::maxTaps;
+
+    int numLines = 0;
+    std::array<float, maxLines> inputPeaks {};     // Gain, not dB
+    std::array<float, maxLines> wetPeaks {};
+    std::array<float, maxLines> delaysMs {};
+
+    float feedback = 0.f;
+    int mode = 0;                                   // PingPongKernelBase::Mode
+    int rotation = 1;                               // Or 0 when a matrix mixes the lines
+
+    int numTaps = 0;                                // Only in multi-tap mode
+    std::array<float, maxTaps> tapScales {};
+    std::array<float, maxTaps> tapGains {};
+
+    bool operator== (const VisualiserFrame& other) const noexcept
+    {
+        return numLines == other.numLines && feedback == other.feedback && mode == other.mode
+            && rotation == other.rotation && numTaps == other.numTaps
+            && inputPeaks == other.inputPeaks && wetPeaks == other.wetPeaks && delaysMs == other.delaysMs
+            && tapScales == other.tapScales && tapGains == other.tapGains;
+    }
+
+    bool operator!= (const VisualiserFrame& other) const noexcept  { return ! operator== (other); }
+};
+
+//==============================================================================
+/**
+    A single producer, single consumer queue of frames. The audio thread
+    pushes and the editor's timer pops; neither ever waits on the other, as
+    juce::AbstractFifo only moves two atomic indices. When the editor falls
+    behind the newest frames are dropped rather than blocking the audio.
+*/
+class VisualiserFifo
+{
+public:
+    static constexpr int capacity = 32;
+
+    /** Audio thread. Returns false if the queue was full. */
+    bool push (const VisualiserFrame& frame) noexcept
+    {
+        auto scope = mFifo.write (1);
+
+        if (scope.blockSize1 > 0)
+            mFrames[(size_t) scope.startIndex1] = frame;
+        else if (scope.blockSize2 > 0)
+            mFrames[(size_t) scope.startIndex2] = frame;
+        else
+            return false;
+
+        return true;
+    }
+
+    /**
+        Editor thread. Empties the queue into frame; the echo pattern comes
+        from the newest frame and the peaks are the loudest of all of them,
+        so a short transient isn't lost between two repaints.
+    */
+    bool popAll (VisualiserFrame& frame) noexcept
+    {
+        auto numReady = mFifo.getNumReady();
+
+        if (numReady == 0)
+            return false;
+
+        auto first = true;
+
+        mFifo.read (numReady).forEach ([&] (int index)
+        {
+            auto& next = mFrames[(size_t) index];
+
+            if (first)
+            {
+                frame = next;
+                first = false;
+                return;
+            }
+
+            auto inputPeaks = frame.inputPeaks;
+            auto wetPeaks = frame.wetPeaks;
+
+            frame = next;
+
+            for (size_t line = 0; line < (size_t) VisualiserFrame::maxLines; ++line)
+            {
+                frame.inputPeaks[line] = juce::jmax (frame.inputPeaks[line], inputPeaks[line]);
+                frame.wetPeaks[line] = juce::jmax (frame.wetPeaks[line], wetPeaks[line]);
+            }
+        });
+
+        return true;
+    }
+
+private:
+    juce::AbstractFifo mFifo { capacity };
+    std::array<VisualiserFrame, capacity> mFrames;
+};
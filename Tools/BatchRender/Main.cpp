@@ -0,0 +1,575 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Parallel batch renderer for TableTennisAudioProcessor.
+
+    Renders a folder, or a list, of files through the processor on every
+    core. Each worker thread has its own processor instance and its own queue
+    of files, and a worker that runs out steals from the others, so one long
+    file doesn't leave the rest of the machine idle. Files are streamed in
+    chunks, so memory use doesn't grow with their length, and each one comes
+    out bit for bit the same as OfflineRender would make it.
+
+    This is a JUCE console application; its target compiles the files in
+    ../../Source next to this one, with the same JucePlugin_ defines as the
+    plug-in. Build it in Release.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage: BatchRender --in-dir <folder> --out-dir <folder> [options]\n"
+                     "       BatchRender --list <file> [options]\n"
+                     "\n"
+                     "  --list <file>         one file per line; <in> <out> [<id>=<value> ...]\n"
+                     "                        (paths relative to the list, quoted if they have spaces)\n"
+                     "  --format <wav|flac>   output format for --out-dir (default wav)\n"
+                     "  --threads <n>         worker threads (default: one per core)\n"
+                     "  --block <samples>     processBlock size (default 512)\n"
+                     "  --chunk <seconds>     how much of a file is read and written at once (default 30)\n"
+                     "  --state <file>        load a state blob saved by getStateInformation\n"
+                     "  --set <id>=<value>    set a parameter for every file, in its own units (repeatable)\n"
+                     "  --tail <seconds>      extra silence rendered after each input\n"
+                     "                        (default: the processor's tail length)\n"
+                     "  --bits <16|24|32>     output bit depth (default: same as the input)\n";
+    }
+
+    //==============================================================================
+    juce::RangedAudioParameter* findParameter (juce::AudioProcessor& processor, const juce::String& id)
+    {
+        for (auto* param : processor.getParameters())
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (param))
+                if (ranged->paramID == id)
+                    return ranged;
+
+        return nullptr;
+    }
+
+    bool setParameter (juce::AudioProcessor& processor, const juce::String& assignment)
+    {
+        auto id = assignment.upToFirstOccurrenceOf ("=", false, false).trim();
+        auto value = assignment.fromFirstOccurrenceOf ("=", false, false).trim();
+
+        auto* param = findParameter (processor, id);
+
+        if (param == nullptr || value.isEmpty())
+            return false;
+
+        param->setValueNotifyingHost (param->convertTo0to1 (value.getFloatValue()));
+        return true;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriter (juce::AudioFormatManager& formats, const juce::File& file,
+                                                           double sampleRate, int numChannels, int bitsPerSample)
+    {
+        auto* format = formats.findFormatForFileExtension (file.getFileExtension());
+
+        if (format == nullptr)
+            return {};
+
+        file.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream> (file);
+
+        if (stream->failedToOpen())
+            return {};
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels,
+                                                                                  bitsPerSample, {}, 0));
+        if (writer != nullptr)
+            stream.release(); // The writer owns the stream now
+
+        return writer;
+    }
+
+    //==============================================================================
+    struct RenderSettings
+    {
+        int blockSize = 512;
+        double chunkSeconds = 30.0;
+        double tailSeconds = -1.0;          // Less than zero for the processor's tail length
+        int bitsPerSample = 0;              // Zero for the same as the input
+    };
+
+    struct RenderJob
+    {
+        juce::File input, output;
+        juce::MemoryBlock state;            // The processor's whole state for this file
+        double inputSeconds = 0.0;
+
+        // Filled in by whichever worker renders it
+        bool succeeded = false;
+        juce::String error;
+        double audioSeconds = 0.0;
+        double processingSeconds = 0.0;
+    };
+
+    //==============================================================================
+    /**
+        One queue of job indices per worker. A worker takes from the front of
+        its own queue and, once that is empty, steals from the back of the
+        others'. The jobs are dealt out longest first, so a worker starts on
+        its biggest files and a thief picks up the small ones left at the end.
+
+        Nothing is added once the workers have started, so a worker that
+        finds every queue empty is done.
+    */
+    class JobQueues
+    {
+    public:
+        explicit JobQueues (int numWorkers) : mQueues ((size_t) numWorkers) {}
+
+        void add (int worker, int job)
+        {
+            auto& queue = mQueues[(size_t) worker];
+
+            const std::lock_guard<std::mutex> lock (queue.lock);
+            queue.jobs.push_back (job);
+        }
+
+        /** The next job for a worker, or -1 when there is nothing left anywhere. */
+        int next (int worker)
+        {
+            auto numQueues = (int) mQueues.size();
+
+            for (int i = 0; i < numQueues; ++i)
+            {
+                auto& queue = mQueues[(size_t) ((worker + i) % numQueues)];
+                auto isOwn = i == 0;
+
+                const std::lock_guard<std::mutex> lock (queue.lock);
+
+                if (queue.jobs.empty())
+                    continue;
+
+                auto job = isOwn ? queue.jobs.front() : queue.jobs.back();
+
+                if (isOwn)
+                    queue.jobs.pop_front();
+                else
+                    queue.jobs.pop_back();
+
+                if (! isOwn)
+                    mNumSteals.fetch_add (1, std::memory_order_relaxed);
+
+                return job;
+            }
+
+            return -1;
+        }
+
+        int getNumSteals() const noexcept       { return mNumSteals.load(); }
+
+    private:
+        struct Queue
+        {
+            std::mutex lock;
+            std::deque<int> jobs;
+        };
+
+        std::vector<Queue> mQueues;
+        std::atomic<int> mNumSteals { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE (JobQueues)
+    };
+
+    //==============================================================================
+    class RenderWorker  : public juce::Thread
+    {
+    public:
+        RenderWorker (int index, JobQueues& queues, std::vector<RenderJob>& jobs, const RenderSettings& settings)
+            : juce::Thread ("BatchRender worker " + juce::String (index)),
+              mIndex (index), mQueues (queues), mJobs (jobs), mSettings (settings)
+        {
+            // Made here, on the message thread, since treeState needs one
+            mProcessor = std::make_unique<TableTennisAudioProcessor>();
+            mProcessor->setNonRealtime (true);
+
+            mFormats.registerBasicFormats();
+        }
+
+        ~RenderWorker() override
+        {
+            stopThread (-1);
+        }
+
+        void run() override
+        {
+            for (auto job = mQueues.next (mIndex); job >= 0 && ! threadShouldExit(); job = mQueues.next (mIndex))
+            {
+                auto& renderJob = mJobs[(size_t) job];
+                renderJob.succeeded = render (renderJob);
+
+                report (renderJob);
+            }
+        }
+
+    private:
+        bool render (RenderJob& job)
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader (mFormats.createReaderFor (job.input));
+
+            if (reader == nullptr)
+            {
+                job.error = "couldn't open the input";
+                return false;
+            }
+
+            auto sampleRate = reader->sampleRate;
+            auto bitsPerSample = mSettings.bitsPerSample > 0 ? mSettings.bitsPerSample : (int) reader->bitsPerSample;
+
+            if (job.output.hasFileExtension ("flac"))
+                bitsPerSample = juce::jmin (24, bitsPerSample);
+
+            // The processor is stereo; a mono file is fed to both sides
+            constexpr int numChannels = 2;
+
+            auto writer = createWriter (mFormats, job.output, sampleRate, numChannels, bitsPerSample);
+
+            if (writer == nullptr)
+            {
+                job.error = "couldn't create the output";
+                return false;
+            }
+
+            auto blockSize = mSettings.blockSize;
+
+            // Whatever the last file left behind is cleared by the new state and prepareToPlay
+            mProcessor->setStateInformation (job.state.getData(), (int) job.state.getSize());
+            mProcessor->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+            mProcessor->prepareToPlay (sampleRate, blockSize);
+
+            auto tailSeconds = mSettings.tailSeconds >= 0.0 ? mSettings.tailSeconds : mProcessor->getTailLengthSeconds();
+
+            auto inputLength = reader->lengthInSamples;
+            auto totalLength = inputLength + (juce::int64) std::ceil (tailSeconds * sampleRate);
+
+            /*
+                The file goes through one chunk at a time; each chunk is read
+                in one go, processed block by block and written in one go.
+                The processor stays prepared from one chunk to the next, so
+                the delay lines, filters and ramps carry straight over, and a
+                chunk is a whole number of blocks, so the processor is handed
+                exactly the blocks a serial render would give it.
+            */
+
+            auto blocksPerChunk = juce::jmax (1, (int) (mSettings.chunkSeconds * sampleRate) / blockSize);
+            auto chunkSize = (int) juce::jmin ((juce::int64) blocksPerChunk * blockSize, juce::jmax ((juce::int64) 1, totalLength));
+
+            mChunk.setSize (numChannels, chunkSize, false, false, true);
+
+            juce::MidiBuffer midi;
+            double processingSeconds = 0.0;
+
+            for (juce::int64 position = 0; position < totalLength; position += chunkSize)
+            {
+                auto numSamples = (int) juce::jmin ((juce::int64) chunkSize, totalLength - position);
+
+                mChunk.setSize (numChannels, numSamples, false, false, true);
+                mChunk.clear();
+
+                if (position < inputLength)
+                {
+                    auto numToRead = (int) juce::jmin ((juce::int64) numSamples, inputLength - position);
+
+                    reader->read (&mChunk, 0, numToRead, position, true, true);
+
+                    if (reader->numChannels == 1)
+                        mChunk.copyFrom (1, 0, mChunk, 0, 0, numToRead);
+                }
+
+                auto startTicks = juce::Time::getHighResolutionTicks();
+
+                for (int offset = 0; offset < numSamples; offset += blockSize)
+                {
+                    juce::AudioBuffer<float> block (mChunk.getArrayOfWritePointers(), numChannels,
+                                                    offset, juce::jmin (blockSize, numSamples - offset));
+
+                    mProcessor->processBlock (block, midi);
+                }
+
+                processingSeconds += juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+                if (! writer->writeFromAudioSampleBuffer (mChunk, 0, numSamples))
+                {
+                    job.error = "write failed at sample " + juce::String (position);
+                    mProcessor->releaseResources();
+                    return false;
+                }
+
+                if (threadShouldExit())
+                    break;
+            }
+
+            mProcessor->releaseResources();
+
+            job.audioSeconds = (double) totalLength / sampleRate;
+            job.processingSeconds = processingSeconds;
+            return true;
+        }
+
+        void report (const RenderJob& job)
+        {
+            static std::mutex outputLock;
+            const std::lock_guard<std::mutex> lock (outputLock);
+
+            if (job.succeeded)
+                std::cout << "[" << mIndex << "] " << job.output.getFullPathName() << "  "
+                          << juce::String (job.audioSeconds, 2) << " s, "
+                          << juce::String (job.processingSeconds > 0.0 ? job.audioSeconds / job.processingSeconds : 0.0, 1) << "x\n";
+            else
+                std::cerr << "[" << mIndex << "] " << job.input.getFullPathName() << ": " << job.error << "\n";
+        }
+
+        const int mIndex;
+        JobQueues& mQueues;
+        std::vector<RenderJob>& mJobs;
+        const RenderSettings& mSettings;
+
+        std::unique_ptr<TableTennisAudioProcessor> mProcessor;
+        juce::AudioFormatManager mFormats;
+        juce::AudioBuffer<float> mChunk;
+
+        JUCE_DECLARE_NON_COPYABLE (RenderWorker)
+    };
+
+    //==============================================================================
+    bool readJobList (const juce::File& listFile, std::vector<RenderJob>& jobs, std::vector<juce::StringArray>& assignments)
+    {
+        if (! listFile.existsAsFile())
+            return false;
+
+        juce::StringArray lines;
+        listFile.readLines (lines);
+
+        for (auto& line : lines)
+        {
+            if (line.trim().isEmpty() || line.trim().startsWithChar ('#'))
+                continue;
+
+            juce::StringArray tokens;
+            tokens.addTokens (line, " \t", "\"");
+            tokens.removeEmptyStrings();
+
+            if (tokens.size() < 2)
+            {
+                std::cerr << "Expected <in> <out> in: " << line << "\n";
+                return false;
+            }
+
+            RenderJob job;
+            job.input = listFile.getParentDirectory().getChildFile (tokens[0].unquoted());
+            job.output = listFile.getParentDirectory().getChildFile (tokens[1].unquoted());
+
+            jobs.push_back (std::move (job));
+
+            tokens.removeRange (0, 2);
+            assignments.push_back (tokens);
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // treeState needs a message manager, not a display
+
+    juce::ArgumentList args (argc, argv);
+
+    auto hasFolders = args.containsOption ("--in-dir") && args.containsOption ("--out-dir");
+
+    if (! hasFolders && ! args.containsOption ("--list"))
+    {
+        printUsage();
+        return 1;
+    }
+
+    RenderSettings settings;
+
+    if (args.containsOption ("--block"))
+        settings.blockSize = juce::jmax (1, args.getValueForOption ("--block").getIntValue());
+
+    if (args.containsOption ("--chunk"))
+        settings.chunkSeconds = juce::jmax (0.0, args.getValueForOption ("--chunk").getDoubleValue());
+
+    if (args.containsOption ("--tail"))
+        settings.tailSeconds = juce::jmax (0.0, args.getValueForOption ("--tail").getDoubleValue());
+
+    if (args.containsOption ("--bits"))
+        settings.bitsPerSample = args.getValueForOption ("--bits").getIntValue();
+
+    //==============================================================================
+    // The files to render, and any per-file settings
+
+    std::vector<RenderJob> jobs;
+    std::vector<juce::StringArray> assignments;
+
+    if (hasFolders)
+    {
+        auto inputFolder = args.getFileForOption ("--in-dir");
+        auto outputFolder = args.getFileForOption ("--out-dir");
+        auto extension = args.containsOption ("--format") ? args.getValueForOption ("--format") : juce::String ("wav");
+
+        if (! outputFolder.createDirectory())
+        {
+            std::cerr << "Couldn't create " << outputFolder.getFullPathName() << "\n";
+            return 1;
+        }
+
+        for (auto& input : inputFolder.findChildFiles (juce::File::findFiles, false, "*.wav;*.aif;*.aiff;*.flac"))
+        {
+            RenderJob job;
+            job.input = input;
+            job.output = outputFolder.getChildFile (input.getFileNameWithoutExtension() + "." + extension);
+
+            jobs.push_back (std::move (job));
+            assignments.emplace_back();
+        }
+    }
+    else if (! readJobList (args.getFileForOption ("--list"), jobs, assignments))
+    {
+        std::cerr << "Couldn't read the list " << args.getFileForOption ("--list").getFullPathName() << "\n";
+        return 1;
+    }
+
+    if (jobs.empty())
+    {
+        std::cerr << "Nothing to render\n";
+        return 1;
+    }
+
+    //==============================================================================
+    /*
+        Every file's settings are worked out here, up front, as a whole state
+        blob; the state file first, then the --set options, then the file's
+        own. A worker just loads the blob, so nothing from the file it
+        rendered before can leak into the next one.
+    */
+
+    {
+        auto processor = std::make_unique<TableTennisAudioProcessor>();
+
+        if (args.containsOption ("--state"))
+        {
+            juce::MemoryBlock state;
+            auto stateFile = args.getFileForOption ("--state");
+
+            if (! stateFile.loadFileAsData (state) || state.getSize() == 0)
+            {
+                std::cerr << "Couldn't read state from " << stateFile.getFullPathName() << "\n";
+                return 1;
+            }
+
+            processor->setStateInformation (state.getData(), (int) state.getSize());
+        }
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            if (args[i] == "--set" && i + 1 < args.size())
+            {
+                if (! setParameter (*processor, args[i + 1].text))
+                {
+                    std::cerr << "Unknown parameter or missing value: " << args[i + 1].text << "\n";
+                    return 1;
+                }
+            }
+        }
+
+        juce::MemoryBlock sharedState;
+        processor->getStateInformation (sharedState);
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            processor->setStateInformation (sharedState.getData(), (int) sharedState.getSize());
+
+            for (auto& assignment : assignments[i])
+            {
+                if (! setParameter (*processor, assignment))
+                {
+                    std::cerr << "Unknown parameter or missing value for " << jobs[i].input.getFileName() << ": " << assignment << "\n";
+                    return 1;
+                }
+            }
+
+            processor->getStateInformation (jobs[i].state);
+
+            // Only the length is needed here, for dealing the files out
+            if (std::unique_ptr<juce::AudioFormatReader> reader { formats.createReaderFor (jobs[i].input) })
+                jobs[i].inputSeconds = (double) reader->lengthInSamples / reader->sampleRate;
+        }
+    }
+
+    std::stable_sort (jobs.begin(), jobs.end(), [] (const RenderJob& a, const RenderJob& b) { return a.inputSeconds > b.inputSeconds; });
+
+    //==============================================================================
+    auto numWorkers = args.containsOption ("--threads") ? args.getValueForOption ("--threads").getIntValue()
+                                                        : juce::SystemStats::getNumCpus();
+
+    numWorkers = juce::jlimit (1, (int) jobs.size(), numWorkers);
+
+    JobQueues queues (numWorkers);
+
+    for (int job = 0; job < (int) jobs.size(); ++job)
+        queues.add (job % numWorkers, job);
+
+    juce::OwnedArray<RenderWorker> workers;
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add (new RenderWorker (i, queues, jobs, settings));
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto* worker : workers)
+        worker->startThread();
+
+    for (auto* worker : workers)
+        worker->waitForThreadToExit (-1);
+
+    auto wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+    workers.clear();
+
+    //==============================================================================
+    /*
+        The aggregate throughput is the audio rendered per second of wall
+        time. Dividing it by what one core manages (the audio per second of
+        processBlock time) gives how many cores' worth of work the batch
+        actually got, to compare with the number of workers.
+    */
+
+    int numFailed = 0;
+    double audioSeconds = 0.0, processingSeconds = 0.0;
+
+    for (auto& job : jobs)
+    {
+        numFailed += job.succeeded ? 0 : 1;
+        audioSeconds += job.audioSeconds;
+        processingSeconds += job.processingSeconds;
+    }
+
+    auto throughput = wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0;
+    auto perCore = processingSeconds > 0.0 ? audioSeconds / processingSeconds : 0.0;
+
+    std::cout << "\n"
+              << "Rendered " << (int) jobs.size() - numFailed << " of " << (int) jobs.size() << " files, "
+              << juce::String (audioSeconds, 1) << " s of audio, on " << numWorkers << " workers ("
+              << queues.getNumSteals() << " stolen)\n"
+              << "Wall time " << juce::String (wallSeconds, 2) << " s, aggregate throughput "
+              << juce::String (throughput, 1) << "x real time\n"
+              << "processBlock " << juce::String (perCore, 1) << "x real time per core, effective cores "
+              << juce::String (perCore > 0.0 ? throughput / perCore : 0.0, 2) << "\n";
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    processBlock microbenchmarks for TableTennisAudioProcessor.
+
+    Runs the processor across block sizes, sample rates, delay lengths either
+    side of the block size and bypass on/off. For each case it reports the
+    time and cycles per sample and the heap allocations made per processBlock
+    call. The results are written as JSON so that they can be compared from
+    one release to the next.
+
+    This is a JUCE console application; its target compiles the files in
+    ../../Source next to this one, with the same JucePlugin_ defines as the
+    plug-in. Build it in Release.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+/*
+    Counts every heap allocation made while sCountAllocations is set, which is
+    only ever true around the measured processBlock calls.
+*/
+
+static std::atomic<bool> sCountAllocations { false };
+static std::atomic<juce::int64> sAllocationCount { 0 };
+
+void* operator new (std::size_t size)
+{
+    if (sCountAllocations.load (std::memory_order_relaxed))
+        sAllocationCount.fetch_add (1, std::memory_order_relaxed);
+
+    if (auto* ptr = std::malloc (size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)                  { return operator new (size); }
+void operator delete (void* ptr) noexcept                { std::free (ptr); }
+void operator delete[] (void* ptr) noexcept              { std::free (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept   { std::free (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept { std::free (ptr); }
+
+namespace
+{
+    //==============================================================================
+    /** Reads the CPU's cycle counter, or returns 0 where there isn't one we can use. */
+    juce::uint64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return (juce::uint64) __rdtsc();
+       #elif JUCE_ARM && JUCE_64BIT && ! JUCE_MSVC
+        juce::uint64 ticks;
+        asm volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+        return ticks;
+       #else
+        return 0;
+       #endif
+    }
+
+    //==============================================================================
+    struct BenchmarkCase
+    {
+        int blockSize;
+        double sampleRate;
+        float delayTimeMs;
+        bool bypass;
+    };
+
+    struct BenchmarkResult
+    {
+        double nsPerSample = 0.0;
+        double cyclesPerSample = 0.0;
+        double allocationsPerCall = 0.0;
+        juce::int64 calls = 0;
+    };
+
+    void setParameter (juce::AudioProcessor& processor, const juce::String& id, float value)
+    {
+        for (auto* param : processor.getParameters())
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (param))
+                if (ranged->paramID == id)
+                    ranged->setValueNotifyingHost (ranged->convertTo0to1 (value));
+    }
+
+    //==============================================================================
+    BenchmarkResult runCase (const BenchmarkCase& benchCase, juce::int64 samplesPerCase)
+    {
+        constexpr int numChannels = 2;
+
+        TableTennisAudioProcessor processor;
+
+        setParameter (processor, "delayTime", benchCase.delayTimeMs);
+        setParameter (processor, "offsetL", 0.f);
+        setParameter (processor, "offsetR", 0.f);
+        setParameter (processor, "feedback", 0.6f);
+        setParameter (processor, "mix", 0.5f);
+        setParameter (processor, "gain", 0.8f);
+        setParameter (processor, "audioBypass", benchCase.bypass ? 1.f : 0.f);
+
+        processor.setPlayConfigDetails (numChannels, numChannels, benchCase.sampleRate, benchCase.blockSize);
+        processor.prepareToPlay (benchCase.sampleRate, benchCase.blockSize);
+
+        juce::AudioBuffer<float> buffer (numChannels, benchCase.blockSize);
+        juce::MidiBuffer midi;
+        juce::Random random (0x7AB1E);
+
+        auto refill = [&]
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < benchCase.blockSize; ++i)
+                    buffer.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+        };
+
+        // Warm up, letting the parameter ramps settle and the buffers get paged in
+
+        auto warmUpCalls = juce::jmax ((juce::int64) 8, (juce::int64) (benchCase.sampleRate * 0.5) / benchCase.blockSize);
+
+        for (juce::int64 i = 0; i < warmUpCalls; ++i)
+        {
+            refill();
+            processor.processBlock (buffer, midi);
+        }
+
+        /*
+            The input is refreshed between calls but outside the timed region,
+            so that the feedback can't decay into denormals or silence.
+        */
+
+        BenchmarkResult result;
+        result.calls = juce::jmax ((juce::int64) 16, samplesPerCase / benchCase.blockSize);
+
+        double seconds = 0.0;
+        juce::uint64 cycles = 0;
+        juce::int64 allocations = 0;
+
+        for (juce::int64 i = 0; i < result.calls; ++i)
+        {
+            refill();
+
+            sAllocationCount.store (0);
+            sCountAllocations.store (true);
+
+            auto startCycles = readCycleCounter();
+            auto startTicks = juce::Time::getHighResolutionTicks();
+
+            processor.processBlock (buffer, midi);
+
+            auto endTicks = juce::Time::getHighResolutionTicks();
+            auto endCycles = readCycleCounter();
+
+            sCountAllocations.store (false);
+
+            seconds += juce::Time::highResolutionTicksToSeconds (endTicks - startTicks);
+            cycles += endCycles - startCycles;
+            allocations += sAllocationCount.load();
+        }
+
+        processor.releaseResources();
+
+        auto totalSamples = (double) (result.calls * benchCase.blockSize);
+
+        result.nsPerSample = seconds * 1.0e9 / totalSamples;
+        result.cyclesPerSample = (double) cycles / totalSamples;
+        result.allocationsPerCall = (double) allocations / (double) result.calls;
+
+        return result;
+    }
+
+    juce::var toJson (const BenchmarkCase& benchCase, const BenchmarkResult& result)
+    {
+        auto delayInSamples = juce::roundToInt (benchCase.delayTimeMs * benchCase.sampleRate / 1000.0);
+
+        auto* object = new juce::DynamicObject();
+
+        object->setProperty ("blockSize", benchCase.blockSize);
+        object->setProperty ("sampleRate", benchCase.sampleRate);
+        object->setProperty ("delayMs", benchCase.delayTimeMs);
+        object->setProperty ("delaySamples", delayInSamples);
+        object->setProperty ("delayShorterThanBlock", delayInSamples < benchCase.blockSize);
+        object->setProperty ("bypass", benchCase.bypass);
+        object->setProperty ("calls", result.calls);
+        object->setProperty ("nsPerSample", result.nsPerSample);
+        object->setProperty ("cyclesPerSample", result.cyclesPerSample > 0.0 ? juce::var (result.cyclesPerSample) : juce::var());
+        object->setProperty ("allocationsPerCall", result.allocationsPerCall);
+
+        return juce::var (object);
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: Benchmark [options]\n"
+                     "\n"
+                     "  --out <file.json>     write the results here instead of stdout\n"
+                     "  --samples <n>         audio samples measured per case (default 262144)\n"
+                     "  --quick               only 64, 256 and 1024 sample blocks at 48kHz\n";
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // treeState needs a message manager, not a display
+
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    auto samplesPerCase = args.containsOption ("--samples") ? juce::jmax ((juce::int64) 1, args.getValueForOption ("--samples").getLargeIntValue())
+                                                            : (juce::int64) 262144;
+
+    juce::Array<int> blockSizes { 1, 16, 64, 256, 1024, 4096, 8192 };
+    juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0 };
+
+    if (args.containsOption ("--quick"))
+    {
+        blockSizes = { 64, 256, 1024 };
+        sampleRates = { 48000.0 };
+    }
+
+    /*
+        A 1ms delay is 44 to 192 samples, so it is shorter than most of the
+        blocks and exercises the delay-length spans. 500ms is longer than
+        any block.
+    */
+
+    const float delayTimes[] = { 1.f, 500.f };
+
+    juce::Array<juce::var> results;
+
+    for (auto sampleRate : sampleRates)
+        for (auto blockSize : blockSizes)
+            for (auto delayTimeMs : delayTimes)
+                for (auto bypass : { false, true })
+                {
+                    BenchmarkCase benchCase { blockSize, sampleRate, delayTimeMs, bypass };
+                    auto result = runCase (benchCase, samplesPerCase);
+
+                    std::cerr << (int) sampleRate << " Hz, block " << blockSize << ", delay " << delayTimeMs << " ms"
+                              << (bypass ? ", bypassed" : "") << ": " << juce::String (result.nsPerSample, 3) << " ns/sample\n";
+
+                    results.add (toJson (benchCase, result));
+                }
+
+    auto* root = new juce::DynamicObject();
+
+    root->setProperty ("plugin", JucePlugin_Name);
+    root->setProperty ("version", JucePlugin_VersionString);
+    root->setProperty ("timestamp", juce::Time::getCurrentTime().toISO8601 (true));
+    root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty ("results", results);
+
+    auto json = juce::JSON::toString (juce::var (root));
+
+    if (args.containsOption ("--out"))
+    {
+        auto outputFile = args.getFileForOption ("--out");
+
+        if (! outputFile.replaceWithText (json))
+        {
+            std::cerr << "Couldn't write " << outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << "\n";
+    }
+
+    return 0;
+}
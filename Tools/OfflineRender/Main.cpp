@@ -0,0 +1,250 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless offline renderer for TableTennisAudioProcessor.
+
+    Streams an audio file through the processor's processBlock, one block at a
+    time, and writes the result. No editor and no audio device are created, so
+    it runs on a server with no display.
+
+    This is a JUCE console application; its target compiles the files in
+    ../../Source next to this one, with the same JucePlugin_ defines as the
+    plug-in.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage: OfflineRender --in <file> --out <file.wav|file.flac> [options]\n"
+                     "\n"
+                     "  --block <samples>     processBlock size (default 512)\n"
+                     "  --state <file>        load a state blob saved by getStateInformation\n"
+                     "  --set <id>=<value>    set a parameter, in its own units (repeatable)\n"
+                     "  --tail <seconds>      extra silence rendered after the input\n"
+                     "                        (default: the processor's tail length)\n"
+                     "  --bits <16|24|32>     output bit depth (default: same as the input)\n"
+                     "  --list-params         print the parameter IDs and ranges, then exit\n";
+    }
+
+    //==============================================================================
+    juce::RangedAudioParameter* findParameter (juce::AudioProcessor& processor, const juce::String& id)
+    {
+        for (auto* param : processor.getParameters())
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (param))
+                if (ranged->paramID == id)
+                    return ranged;
+
+        return nullptr;
+    }
+
+    void listParameters (juce::AudioProcessor& processor)
+    {
+        for (auto* param : processor.getParameters())
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (param))
+            {
+                auto& range = ranged->getNormalisableRange();
+
+                std::cout << ranged->paramID << "  \"" << ranged->getName (64) << "\"  "
+                          << range.start << " .. " << range.end
+                          << "  (default " << range.convertFrom0to1 (ranged->getDefaultValue()) << ")\n";
+            }
+    }
+
+    bool loadState (juce::AudioProcessor& processor, const juce::File& file)
+    {
+        juce::MemoryBlock state;
+
+        if (! file.loadFileAsData (state) || state.getSize() == 0)
+            return false;
+
+        processor.setStateInformation (state.getData(), (int) state.getSize());
+        return true;
+    }
+
+    bool setParameter (juce::AudioProcessor& processor, const juce::String& assignment)
+    {
+        auto id = assignment.upToFirstOccurrenceOf ("=", false, false).trim();
+        auto value = assignment.fromFirstOccurrenceOf ("=", false, false).trim();
+
+        auto* param = findParameter (processor, id);
+
+        if (param == nullptr || value.isEmpty())
+            return false;
+
+        param->setValueNotifyingHost (param->convertTo0to1 (value.getFloatValue()));
+        return true;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriter (juce::AudioFormatManager& formats, const juce::File& file,
+                                                           double sampleRate, int numChannels, int bitsPerSample)
+    {
+        auto* format = formats.findFormatForFileExtension (file.getFileExtension());
+
+        if (format == nullptr)
+            return {};
+
+        file.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream> (file);
+
+        if (stream->failedToOpen())
+            return {};
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels,
+                                                                                  bitsPerSample, {}, 0));
+        if (writer != nullptr)
+            stream.release(); // The writer owns the stream now
+
+        return writer;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // treeState needs a message manager, not a display
+
+    juce::ArgumentList args (argc, argv);
+
+    auto processor = std::make_unique<TableTennisAudioProcessor>();
+
+    if (args.containsOption ("--list-params"))
+    {
+        listParameters (*processor);
+        return 0;
+    }
+
+    if (! args.containsOption ("--in") || ! args.containsOption ("--out"))
+    {
+        printUsage();
+        return 1;
+    }
+
+    auto inputFile = args.getFileForOption ("--in");
+    auto outputFile = args.getFileForOption ("--out");
+    auto blockSize = args.containsOption ("--block") ? juce::jmax (1, args.getValueForOption ("--block").getIntValue())
+                                                     : 512;
+
+    //==============================================================================
+    // Settings; the state blob first, so that --set can override parts of it
+
+    if (args.containsOption ("--state"))
+    {
+        auto stateFile = args.getFileForOption ("--state");
+
+        if (! loadState (*processor, stateFile))
+        {
+            std::cerr << "Couldn't read state from " << stateFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--set" && i + 1 < args.size())
+        {
+            if (! setParameter (*processor, args[i + 1].text))
+            {
+                std::cerr << "Unknown parameter or missing value: " << args[i + 1].text << "\n";
+                return 1;
+            }
+        }
+    }
+
+    //==============================================================================
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (inputFile));
+
+    if (reader == nullptr)
+    {
+        std::cerr << "Couldn't open " << inputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    auto sampleRate = reader->sampleRate;
+    auto bitsPerSample = args.containsOption ("--bits") ? args.getValueForOption ("--bits").getIntValue()
+                                                        : (int) reader->bitsPerSample;
+
+    if (outputFile.hasFileExtension ("flac"))
+        bitsPerSample = juce::jmin (24, bitsPerSample);
+
+    // The processor is stereo; a mono file is fed to both sides
+    constexpr int numChannels = 2;
+
+    auto writer = createWriter (formats, outputFile, sampleRate, numChannels, bitsPerSample);
+
+    if (writer == nullptr)
+    {
+        std::cerr << "Couldn't create " << outputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    processor->setNonRealtime (true);
+    processor->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+    processor->prepareToPlay (sampleRate, blockSize);
+
+    auto tailSeconds = args.containsOption ("--tail") ? args.getValueForOption ("--tail").getDoubleValue()
+                                                      : processor->getTailLengthSeconds();
+
+    auto inputLength = reader->lengthInSamples;
+    auto totalLength = inputLength + (juce::int64) std::ceil (juce::jmax (0.0, tailSeconds) * sampleRate);
+
+    //==============================================================================
+    /*
+        The render loop only ever holds one block of audio, so memory use stays
+        the same however long the file is.
+    */
+
+    juce::AudioBuffer<float> block (numChannels, blockSize);
+    juce::MidiBuffer midi;
+
+    double processingSeconds = 0.0;
+
+    for (juce::int64 position = 0; position < totalLength; position += blockSize)
+    {
+        auto numSamples = (int) juce::jmin ((juce::int64) blockSize, totalLength - position);
+
+        block.setSize (numChannels, numSamples, false, false, true);
+        block.clear();
+
+        if (position < inputLength)
+        {
+            auto numToRead = (int) juce::jmin ((juce::int64) numSamples, inputLength - position);
+
+            reader->read (&block, 0, numToRead, position, true, true);
+
+            if (reader->numChannels == 1)
+                block.copyFrom (1, 0, block, 0, 0, numToRead);
+        }
+
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        processor->processBlock (block, midi);
+        processingSeconds += juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+        if (! writer->writeFromAudioSampleBuffer (block, 0, numSamples))
+        {
+            std::cerr << "Write failed at sample " << position << "\n";
+            return 1;
+        }
+    }
+
+    processor->releaseResources();
+    writer.reset();
+
+    auto audioSeconds = (double) totalLength / sampleRate;
+
+    std::cout << "Rendered " << juce::String (audioSeconds, 2) << " s to " << outputFile.getFullPathName() << "\n"
+              << "processBlock time " << juce::String (processingSeconds, 3) << " s, real-time factor "
+              << juce::String (processingSeconds > 0.0 ? audioSeconds / processingSeconds : 0.0, 1) << "x\n";
+
+    return 0;
+}
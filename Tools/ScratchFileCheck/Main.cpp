@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Checks that delay lines in a mapped scratch file sound exactly like
+    delay lines in RAM.
+
+    Two PingPongKernels are prepared with the same lines, one in a scratch
+    file and one in RAM, and run side by side over the same noise bursts;
+    with delay glides and jumps, a reset, and lines coming in and out of use
+    part way through. Their outputs have to match sample for sample, for
+    every interpolation and mode, in both precisions. The RAM kernel is also
+    checked against a fresh one from the reset on, so a cleared line can't
+    replay what it held before. Last, the long delay mode has to turn itself
+    down to the usual length when no scratch file can be made.
+
+    This is a plain C++17 console program, without JUCE, so that it runs on
+    any POSIX box; from this directory,
+
+        c++ -std=c++17 -O2 Main.cpp ../../Source/PingPongEngine.cpp
+            ../../Source/PingPongKernel.cpp ../../Source/FeedbackDiffuser.cpp
+            ../../Source/DelayMemoryPool.cpp ../../Source/DelayPager.cpp
+            -lpthread -o ScratchFileCheck
+
+    The scratch files go in the system's temporary directory, or the one
+    given as the first argument. It exits with 1 if anything differs.
+
+  ==============================================================================
+*/
+
+#include "../../Source/PingPongEngine.h"
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+namespace
+{
+    //==============================================================================
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 240;                                  // Every second starts a block
+    constexpr int numChannels = 2;
+    constexpr int numLines = 2 * numChannels;                       // Room for a second band
+    constexpr int maximumDelay = 2 * (int) sampleRate;             // Short enough to wrap round before the reset
+    constexpr int totalLength = 8 * (int) sampleRate;
+
+    constexpr int resetAt = 3 * (int) sampleRate;
+
+    using Kernel = PingPongKernelBase;
+
+    /*
+        The delay of the first line, in samples, at any point of the run; the
+        others are a little longer. It glides up, jumps down across the
+        reset, and then jumps back up to before the reset, so its reads
+        cross the edge of what has been written since.
+    */
+
+    float getDelay (int position, int line) noexcept
+    {
+        auto spread = 600.f * (float) line;
+
+        if (position < 1 * (int) sampleRate)    return 33600.f + spread;
+        if (position < 2 * (int) sampleRate)    return 33600.f + 0.2f * (float) (position - (int) sampleRate) + spread;
+        if (position < resetAt)                 return 43200.f + spread;
+        if (position < resetAt + 24000)         return 19200.5f + spread;
+
+        return 80000.25f + spread;
+    }
+
+    // The second band's lines run for a second, and then come back after the reset
+    int getNumActiveLines (int position) noexcept
+    {
+        auto isRunning = [position] (int second) { return position >= second * (int) sampleRate && position < (second + 1) * (int) sampleRate; };
+
+        return isRunning (1) || isRunning (4) ? numLines : numChannels;
+    }
+
+    /** Noise bursts of a fifth of a second, once a second, on every line. */
+    std::vector<std::vector<double>> makeInput()
+    {
+        std::mt19937 random (1);
+        std::uniform_real_distribution<double> noise (-0.5, 0.5);
+
+        std::vector<std::vector<double>> input (numLines, std::vector<double> ((size_t) totalLength));
+
+        for (auto& line : input)
+            for (int i = 0; i < totalLength; ++i)
+                if (i % (int) sampleRate < (int) sampleRate / 5)
+                    line[(size_t) i] = noise (random);
+
+        return input;
+    }
+
+    //==============================================================================
+    /**
+        Runs a kernel from startPosition to the end, and returns what it put
+        out on each line. Without a scratchDirectory the lines are in RAM.
+    */
+    template <typename SampleType>
+    std::vector<std::vector<SampleType>> render (const std::vector<std::vector<double>>& input,
+                                                 DelayInterpolation::Type interpolation, Kernel::Mode mode,
+                                                 const std::string& scratchDirectory, int startPosition, bool& isMapped)
+    {
+        PingPongKernel<SampleType> kernel;
+        kernel.prepare (numLines, maximumDelay, blockSize, scratchDirectory);
+        isMapped = kernel.isUsingScratchFile();
+
+        std::vector<std::vector<SampleType>> output (numLines, std::vector<SampleType> ((size_t) totalLength));
+
+        Kernel::TapPattern taps;
+        taps.numTaps = 3;
+        taps.taps[0] = { 0.25f, 0.4f, 0.1f };
+        taps.taps[1] = { 0.5f, 0.1f, 0.4f };
+        taps.taps[2] = { 0.75f, 0.3f, 0.3f };
+
+        Kernel::Parameters params;
+        params.mode = mode;
+        params.interpolation = interpolation;
+        params.routing.groupSize = numChannels;
+        params.taps = &taps;
+        params.mix = { 1.f, 1.f };
+        params.gain = { 1.f, 1.f };
+
+        for (auto& feedback : params.feedback)
+            feedback = { 0.6f, 0.6f };
+
+        for (int position = startPosition; position < totalLength; position += blockSize)
+        {
+            if (position == resetAt)
+                kernel.reset();
+
+            auto numActive = getNumActiveLines (position);
+            kernel.setNumActiveLines (numActive);
+
+            for (int line = 0; line < numActive; ++line)
+                params.delays[(size_t) line] = { getDelay (position, line), getDelay (position + blockSize, line) };
+
+            // A jump in the delay lands on the block it happens in, rather than gliding into it
+            for (int line = 0; line < numActive; ++line)
+                if (std::abs (params.delays[(size_t) line].end - params.delays[(size_t) line].start) > 0.5f * blockSize)
+                    params.delays[(size_t) line].start = params.delays[(size_t) line].end;
+
+            std::array<SampleType*, numLines> channels {};
+
+            for (int line = 0; line < numActive; ++line)
+            {
+                auto& samples = output[(size_t) line];
+
+                for (int i = 0; i < blockSize; ++i)
+                    samples[(size_t) (position + i)] = (SampleType) input[(size_t) line][(size_t) (position + i)];
+
+                channels[(size_t) line] = samples.data() + position;
+            }
+
+            kernel.process (channels.data(), blockSize, params);
+        }
+
+        return output;
+    }
+
+    template <typename SampleType>
+    double getLargestDifference (const std::vector<std::vector<SampleType>>& a, const std::vector<std::vector<SampleType>>& b, int startPosition)
+    {
+        double largest = 0.0;
+
+        for (int line = 0; line < numLines; ++line)
+            for (int i = startPosition; i < totalLength; ++i)
+                largest = std::max (largest, std::abs ((double) a[(size_t) line][(size_t) i] - (double) b[(size_t) line][(size_t) i]));
+
+        return largest;
+    }
+
+    //==============================================================================
+    template <typename SampleType>
+    bool checkKernels (const std::vector<std::vector<double>>& input, const std::string& scratchDirectory)
+    {
+        using Type = DelayInterpolation::Type;
+
+        const std::pair<Type, const char*> interpolations[] = { { Type::none, "none" }, { Type::linear, "linear" },
+                                                                { Type::lagrange3rd, "lagrange" }, { Type::thiran, "thiran" },
+                                                                { Type::windowedSinc, "sinc" } };
+
+        const std::pair<Kernel::Mode, const char*> modes[] = { { Kernel::Mode::pingPong, "ping-pong" },
+                                                               { Kernel::Mode::straight, "straight" },
+                                                               { Kernel::Mode::multiTap, "multi-tap" } };
+
+        auto passed = true;
+
+        for (auto& [interpolation, interpolationName] : interpolations)
+        {
+            for (auto& [mode, modeName] : modes)
+            {
+                bool isMapped = false, isInRam = true, isFresh = true;
+
+                auto mapped = render<SampleType> (input, interpolation, mode, scratchDirectory, 0, isMapped);
+                auto ram = render<SampleType> (input, interpolation, mode, {}, 0, isInRam);
+                auto fresh = render<SampleType> (input, interpolation, mode, {}, resetAt, isFresh);
+
+                if (! isMapped || isInRam || isFresh)
+                {
+                    std::printf ("Couldn't make a scratch file in %s\n", scratchDirectory.c_str());
+                    return false;
+                }
+
+                auto mappedDifference = getLargestDifference (mapped, ram, 0);
+                auto resetDifference = getLargestDifference (ram, fresh, resetAt);
+                auto ok = mappedDifference == 0.0 && resetDifference == 0.0;
+
+                std::printf ("%-6s %-9s %-9s mapped vs RAM %-12g after reset vs fresh %-12g %s\n",
+                             sizeof (SampleType) == sizeof (float) ? "float" : "double", interpolationName, modeName,
+                             mappedDifference, resetDifference, ok ? "ok" : "FAILED");
+
+                passed = passed && ok;
+            }
+        }
+
+        return passed;
+    }
+
+    bool checkLongDelayFallback (const std::string& scratchDirectory)
+    {
+        auto isUsingScratchFile = [] (const std::string& directory)
+        {
+            PingPongEngine engine;
+            engine.setLongDelayMode (true, directory);
+            engine.prepare (sampleRate, blockSize, numChannels);
+            return engine.isUsingScratchFile();
+        };
+
+        auto withFile = isUsingScratchFile (scratchDirectory);
+        auto withoutFile = isUsingScratchFile ((std::filesystem::path (scratchDirectory) / "missing" / "directory").string());
+        auto ok = withFile && ! withoutFile;
+
+        std::printf ("long delay mode with a scratch file %d, without one %d %s\n", (int) withFile, (int) withoutFile, ok ? "ok" : "FAILED");
+
+        return ok;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    auto scratchDirectory = argc > 1 ? std::string (argv[1]) : std::filesystem::temp_directory_path().string();
+    auto input = makeInput();
+
+    auto passed = checkKernels<float> (input, scratchDirectory);
+    passed = checkKernels<double> (input, scratchDirectory) && passed;
+    passed = checkLongDelayFallback (scratchDirectory) && passed;
+
+    std::printf (passed ? "All passed\n" : "Some checks FAILED\n");
+
+    return passed ? 0 : 1;
+}